@@ -0,0 +1,666 @@
+/*
+ * Micro benchmarks for dynamic, concurrent_dynamic, dynamic_json, dynamic_writer, dynamic_store
+ * and dynamic_factory
+ *
+ * Usage: dynamic_bench [--filter TEXT] [--threads N] [--repeat N] [--csv]
+ *
+ * Every benchmark is run --repeat times, median is reported. Allocation counters
+ * are collected by replaced global operator new and are exact for the measured loop.
+ * Built with DYNAMIC_STATISTICS, dynamic instrumentation counters are printed at the end.
+ */
+#include "dynamic.h"
+#include "dynamic_batch.h"
+#include "dynamic_factory.h"
+#include "concurrent_dynamic.h"
+#include "dynamic_json.h"
+#include "dynamic_store.h"
+#include "dynamic_writer.h"
+#include "prepared_dynamic.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// - Allocation counters, thread local to keep counting off the measured path
+namespace {
+  thread_local std::size_t Allocations = 0;
+  thread_local std::size_t AllocatedBytes = 0;
+
+  //! Allocate counted storage, all replaced operator new forms end here
+  void * allocate(std::size_t Size, std::size_t Alignment) {
+    ++Allocations;
+    AllocatedBytes += Size;
+    Alignment = std::max(Alignment, sizeof(void*));
+    Size = (std::max<std::size_t>(Size, 1) + Alignment - 1) / Alignment * Alignment;
+    if (void * Result = std::aligned_alloc(Alignment, Size)) return Result;
+    throw std::bad_alloc();
+  }
+
+  //! Free storage of allocate(), kept out of line so inlined delete is not matched against new
+  [[gnu::noinline]] void deallocate(void * Pointer) noexcept {std::free(Pointer);}
+}
+
+void * operator new (std::size_t Size)                                                {return allocate(Size, alignof(std::max_align_t));}
+void * operator new[] (std::size_t Size)                                              {return allocate(Size, alignof(std::max_align_t));}
+// - Aligned forms are used by std::pmr::new_delete_resource
+void * operator new (std::size_t Size, std::align_val_t Alignment)                    {return allocate(Size, static_cast<std::size_t>(Alignment));}
+void * operator new[] (std::size_t Size, std::align_val_t Alignment)                  {return allocate(Size, static_cast<std::size_t>(Alignment));}
+
+void operator delete (void * Pointer) noexcept                                        {deallocate(Pointer);}
+void operator delete[] (void * Pointer) noexcept                                      {deallocate(Pointer);}
+void operator delete (void * Pointer, std::size_t) noexcept                           {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::size_t) noexcept                         {deallocate(Pointer);}
+void operator delete (void * Pointer, std::align_val_t) noexcept                      {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::align_val_t) noexcept                    {deallocate(Pointer);}
+void operator delete (void * Pointer, std::size_t, std::align_val_t) noexcept         {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::size_t, std::align_val_t) noexcept       {deallocate(Pointer);}
+
+namespace {
+
+//! Prevent compiler from optimizing out given value
+template <typename T>
+inline void keep(T const & Value) {
+  asm volatile("" : : "g"(&Value) : "memory");
+}
+
+//! Result of single benchmark
+struct result {
+  double Nanoseconds;
+  double Allocations;
+  double Bytes;
+};
+
+//! Benchmark settings
+struct settings {
+  std::string Filter;
+  unsigned    Threads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned    Repeat  = 5;
+  bool        Csv     = false;
+};
+
+settings Settings;
+
+//! Print result row
+void report(const std::string & Name, const result & Result) {
+  if (Settings.Csv) std::printf("%s,%.2f,%.3f,%.1f\n", Name.c_str(), Result.Nanoseconds, Result.Allocations, Result.Bytes);
+  else std::printf("%-48s %12.2f %12.3f %14.1f\n", Name.c_str(), Result.Nanoseconds, Result.Allocations, Result.Bytes);
+}
+
+//! Run one measurement of Body executed Iterations times on given number of threads
+result measure(const std::function<void(std::size_t)> & Body, std::size_t Iterations, unsigned Threads) {
+  std::atomic<std::size_t> TotalAllocations{0}, TotalBytes{0};
+  std::atomic<unsigned>    Ready{0};
+  std::atomic<bool>        Start{false};
+
+  auto Worker = [&]() {
+    ++Ready;
+    while (!Start.load(std::memory_order_acquire)) std::this_thread::yield();
+    std::size_t FirstAllocations = Allocations, FirstBytes = AllocatedBytes;
+    Body(Iterations);
+    TotalAllocations += Allocations - FirstAllocations;
+    TotalBytes       += AllocatedBytes - FirstBytes;
+  };
+
+  std::vector<std::thread> Pool;
+  for (unsigned Index = 1; Index < Threads; ++Index) Pool.emplace_back(Worker);
+  while (Ready.load() + 1 < Threads) std::this_thread::yield();
+
+  // - Calling thread takes part in measurement
+  auto First = std::chrono::steady_clock::now();
+  Start.store(true, std::memory_order_release);
+  Worker();
+  for (std::thread & Thread : Pool) Thread.join();
+  auto Last = std::chrono::steady_clock::now();
+
+  double Operations = static_cast<double>(Iterations) * Threads;
+  return {
+    std::chrono::duration<double, std::nano>(Last - First).count() / static_cast<double>(Iterations),
+    static_cast<double>(TotalAllocations.load()) / Operations,
+    static_cast<double>(TotalBytes.load()) / Operations
+  };
+}
+
+//! Run benchmark with calibrated number of iterations and report median
+void run(const std::string & Name, const std::function<void(std::size_t)> & Body, unsigned Threads = 1) {
+  if (!Settings.Filter.empty() && Name.find(Settings.Filter) == std::string::npos) return;
+
+  // - Calibrate iterations to take about 20ms per run
+  std::size_t Iterations = 64;
+  for (;;) {
+    result Probe = measure(Body, Iterations, 1);
+    if (Probe.Nanoseconds * static_cast<double>(Iterations) > 2e7 || Iterations >= (std::size_t(1) << 30)) break;
+    Iterations *= 4;
+  }
+
+  std::vector<result> Results;
+  for (unsigned Index = 0; Index < Settings.Repeat; ++Index) Results.push_back(measure(Body, Iterations, Threads));
+  std::sort(Results.begin(), Results.end(), [](const result & First, const result & Second) {return First.Nanoseconds < Second.Nanoseconds;});
+  report(Name, Results[Results.size() / 2]);
+}
+
+//! Run benchmark for construction from value, reports heap bytes per object in Bytes column
+template <typename T>
+void construct(const std::string & Name, const T & Value) {
+  run("construct/" + Name, [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic Result(Value);
+      keep(Result);
+    }
+  });
+  run("assign/" + Name, [&](std::size_t Iterations) {
+    dynamic Result;
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      Result = Value;
+      keep(Result);
+    }
+  });
+}
+
+//! Run benchmark for cast of given source to all numeric types
+template <typename T>
+void castTo(const std::string & Name, const dynamic & Source) {
+  run("asNumeric/" + Name, [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      T Result = Source.cast<T>();
+      keep(Result);
+    }
+  });
+}
+
+void castFrom(const std::string & Name, const dynamic & Source) {
+  castTo<std::int8_t>(Name + "->int8", Source);
+  castTo<std::int16_t>(Name + "->int16", Source);
+  castTo<std::int32_t>(Name + "->int32", Source);
+  castTo<std::int64_t>(Name + "->int64", Source);
+  castTo<std::uint8_t>(Name + "->uint8", Source);
+  castTo<std::uint16_t>(Name + "->uint16", Source);
+  castTo<std::uint32_t>(Name + "->uint32", Source);
+  castTo<std::uint64_t>(Name + "->uint64", Source);
+  castTo<float>(Name + "->float", Source);
+  castTo<double>(Name + "->double", Source);
+}
+
+//! Plugins for factory benchmark
+struct base {
+  virtual ~base() {}
+};
+
+struct plugin : public base {
+  int Value = 0;
+};
+
+void benchmarkConstruction() {
+  construct("int8", std::int8_t(42));
+  construct("int16", std::int16_t(42));
+  construct("int32", std::int32_t(42));
+  construct("int64", std::int64_t(42));
+  construct("uint8", std::uint8_t(42));
+  construct("uint16", std::uint16_t(42));
+  construct("uint32", std::uint32_t(42));
+  construct("uint64", std::uint64_t(42));
+  construct("bool", true);
+  construct("float", 42.5f);
+  construct("double", 42.5);
+  construct("cstring/short", "short");
+  construct("cstring/long", "long string value that does not fit into inline storage");
+  construct("string/short", std::string("short"));
+  construct("string/long", std::string(256, 'x'));
+  construct("binary/short", std::vector<std::uint8_t>(8, 1));
+  construct("binary/long", std::vector<std::uint8_t>(256, 1));
+  construct("dynamic/int64", dynamic(std::int64_t(42)));
+  construct("dynamic/string", dynamic(std::string(256, 'x')));
+  construct("dynamic/blob", dynamic(std::vector<std::uint8_t>(1 << 20, 1)));
+
+  run("construct/string&&/long", [](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::string Value(256, 'x');
+      dynamic Result(std::move(Value));
+      keep(Result);
+    }
+  });
+  run("construct/dynamic&&/string", [](std::size_t Iterations) {
+    dynamic Source(std::string(256, 'x'));
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic Result(std::move(Source));
+      keep(Result);
+      Source = std::move(Result);
+    }
+  });
+}
+
+void benchmarkCasts() {
+  castFrom("int8", dynamic(std::int8_t(42)));
+  castFrom("int64", dynamic(std::int64_t(42)));
+  castFrom("uint8", dynamic(std::uint8_t(42)));
+  castFrom("uint64", dynamic(std::uint64_t(42)));
+  castFrom("float", dynamic(42.5f));
+  castFrom("double", dynamic(42.5));
+  castFrom("string", dynamic("42"));
+
+  const prepared_dynamic Prepared("42"), Flag("enabled");
+  const dynamic Text("enabled");
+  run("asNumeric/prepared->int32", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {std::int32_t Result = Prepared.cast<std::int32_t>(); keep(Result);}
+  });
+  run("asNumeric/prepared->double", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {double Result = Prepared.cast<double>(); keep(Result);}
+  });
+  run("bool/string", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Text.cast<bool>(); keep(Result);}
+  });
+  run("bool/prepared", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Flag.cast<bool>(); keep(Result);}
+  });
+
+
+  // - Failed conversions, exception against empty optional
+  const dynamic Word("not a number");
+  run("cast/failure/throw", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::int32_t Result = 0;
+      try {Result = Word.cast<std::int32_t>();} catch (const std::bad_cast &) {}
+      keep(Result);
+    }
+  });
+  run("cast/failure/try_cast", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::int32_t Result = Word.try_cast<std::int32_t>().value_or(0);
+      keep(Result);
+    }
+  });
+
+  // - Column sum, cast per element against type switch hoisted out of the loop
+  std::vector<dynamic> Column(1024, dynamic(std::int32_t(3)));
+  run("sum/cast", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::int64_t Result = 0;
+      for (const dynamic & Value : Column) Result += Value.cast<std::int64_t>();
+      keep(Result);
+    }
+  });
+  run("sum/visit", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::int64_t Result = Column.front().visit([&](auto First) -> std::int64_t {
+        using T = decltype(First);
+        std::int64_t Sum = 0;
+        if constexpr (std::is_arithmetic<T>::value) {
+          for (const dynamic & Value : Column) {
+            const T * Native = Value.get_if<T>();
+            Sum += Native ? static_cast<std::int64_t>(*Native) : Value.cast<std::int64_t>();
+          }
+        }
+        return Sum;
+      });
+      keep(Result);
+    }
+  });
+}
+
+void benchmarkBatch() {
+  // - Export of 64k values in runs of 256, per value cast loop against bulk conversion
+  std::vector<dynamic> Column;
+  for (std::size_t Index = 0; Index < 65536; ++Index) {
+    if ((Index / 256) % 2) Column.emplace_back(static_cast<double>(Index) / 4);
+    else Column.emplace_back(static_cast<std::int32_t>(Index));
+  }
+  std::vector<double>       Numbers(Column.size());
+  std::vector<std::string>  Texts(Column.size());
+  dynamic_batch::pool       Serial(1);
+  dynamic_batch::pool       Parallel(Settings.Threads);
+
+  run("batch/loop/double/64k", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      for (std::size_t Row = 0; Row < Column.size(); ++Row) Numbers[Row] = Column[Row].cast<double>();
+      keep(Numbers);
+    }
+  });
+  run("batch/cast/double/64k", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic_batch::bitmask Errors = dynamic_batch::cast(Column.data(), Column.size(), Numbers.data(), Serial); keep(Errors);}
+  });
+  run("batch/cast/double/64k/threads", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic_batch::bitmask Errors = dynamic_batch::cast(Column.data(), Column.size(), Numbers.data(), Parallel); keep(Errors);}
+  });
+  run("batch/loop/string/64k", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      for (std::size_t Row = 0; Row < Column.size(); ++Row) Texts[Row] = Column[Row].cast<std::string>();
+      keep(Texts);
+    }
+  });
+  run("batch/cast/string/64k", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic_batch::bitmask Errors = dynamic_batch::cast(Column.data(), Column.size(), Texts.data(), Serial); keep(Errors);}
+  });
+  run("batch/assign/double/64k/threads", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic_batch::assign(Numbers.data(), Numbers.size(), Column.data(), Parallel); keep(Column);}
+  });
+}
+
+void benchmarkText() {
+  const dynamic Values[] = {dynamic(std::int32_t(-123456)), dynamic(std::uint64_t(1234567890123ull)), dynamic(3.25), dynamic("text value"), dynamic(std::string(256, 'x'))};
+  const char *  Names[]  = {"int32", "uint64", "double", "string/short", "string/long"};
+  for (std::size_t Index = 0; Index < sizeof(Values) / sizeof(Values[0]); ++Index) {
+    const dynamic & Value = Values[Index];
+    run(std::string("string()/") + Names[Index], [&](std::size_t Iterations) {
+      for (std::size_t Count = 0; Count < Iterations; ++Count) {
+        std::string Result = Value;
+        keep(Result);
+      }
+    });
+  }
+}
+
+void benchmarkComparison() {
+  dynamic Int(std::int32_t(42)), Unsigned(std::uint64_t(42)), Float(42.0), Text("42"), Other("43");
+  run("compare/int32==int32", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Int == Int; keep(Result);}
+  });
+  run("compare/int32<uint64", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Int < Unsigned; keep(Result);}
+  });
+  run("compare/int32==double", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Int == Float; keep(Result);}
+  });
+  run("compare/int32==scalar", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Int == std::int32_t(42); keep(Result);}
+  });
+  run("compare/string<string", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Text < Other; keep(Result);}
+  });
+  run("compare/string==cstring", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Text == "42"; keep(Result);}
+  });
+  run("compare/string==int32", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Text == Int; keep(Result);}
+  });
+
+
+  // - Tag values longer than inline storage, plain and interned
+  const std::string Tag = "status/service-unavailable";
+  const dynamic Plain(Tag), PlainOther(Tag), Atom = dynamic::intern(Tag), AtomOther = dynamic::intern(Tag);
+  run("compare/tag==tag", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Plain == PlainOther; keep(Result);}
+  });
+  run("compare/interned==interned", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Atom == AtomOther; keep(Result);}
+  });
+  run("copy/tag", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic Result = Plain; keep(Result);}
+  });
+  run("copy/interned", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic Result = Atom; keep(Result);}
+  });
+  run("intern/existing", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {dynamic Result = dynamic::intern(Tag); keep(Result);}
+  });
+}
+
+void benchmarkCopy() {
+  dynamic Short("short"), Long(std::string(256, 'x'));
+  std::uint8_t Buffer[256];
+  run("copyTo/short", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {Short.copyTo(Buffer, sizeof(Buffer)); keep(Buffer);}
+  });
+  run("copyTo/long", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {Long.copyTo(Buffer, sizeof(Buffer)); keep(Buffer);}
+  });
+}
+
+void benchmarkJson() {
+  std::string Text = "{\"items\": [\n";
+  for (int Index = 0; Index < 1000; ++Index) {
+    if (Index) Text += ",\n";
+    Text += "    {\"id\": " + std::to_string(Index) + ", \"name\": \"item " + std::to_string(Index) + "\", \"price\": " + std::to_string(Index) + ".25, "
+            "\"active\": true, \"tags\": [\"red\", \"green\", null], \"description\": \"Description of the item long enough to be kept on heap\"}";
+  }
+  Text += "\n  ]\n}\n";
+  const std::string Size = std::to_string(Text.size() / 1024) + "KiB";
+
+  run("json/parse/" + Size, [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic Result = dynamic_json::parse(Text);
+      keep(Result);
+    }
+  });
+  run("json/document/" + Size, [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic_json::document Result(Text);
+      keep(Result);
+    }
+  });
+
+  const dynamic Document = dynamic_json::parse(Text);
+  run("json/lookup", [&](std::size_t Iterations) {
+    const dynamic & Items = Document["items"];
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      std::int64_t Result = Items[Index % Items.length()]["id"];
+      keep(Result);
+    }
+  });
+  run("json/copy", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic Result = Document;
+      keep(Result);
+    }
+  });
+
+  std::string Output;
+  run("json/write/" + Size, [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      Output.clear();
+      dynamic_writer Writer(Output);
+      Writer.write(Document);
+      keep(Output);
+    }
+  });
+
+  // - Response fields rendered one by one, with operator std::string() and with writer
+  const dynamic & Item = Document["items"][0];
+  const std::string_view Fields[] = {"id", "name", "price", "description"};
+  run("json/fields/string()", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      Output.clear();
+      for (std::string_view Field : Fields) {
+        Output += std::string(Field) + "=" + std::string(Item[Field]) + ";";
+      }
+      keep(Output);
+    }
+  });
+  run("json/fields/writer", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      Output.clear();
+      dynamic_writer Writer(Output, dynamic_writer::Format::Text);
+      for (std::string_view Field : Fields) {
+        Writer.raw(Field);
+        Writer.raw("=");
+        Writer.write(Item[Field]);
+        Writer.raw(";");
+      }
+      keep(Output);
+    }
+  });
+}
+
+void benchmarkStore() {
+  // - Table of 100k records, half numbers and half strings, built once
+  const std::string Path = (std::filesystem::temp_directory_path() / "dynamic_bench.store").string();
+  std::filesystem::remove(Path);
+  const std::size_t Records = 100000;
+  {
+    dynamic_store Store(Path);
+    for (std::size_t Index = 0; Index < Records; ++Index) {
+      std::string Key = "key/" + std::to_string(Index);
+      if (Index % 2) Store.put(Key, dynamic(std::int64_t(Index)));
+      else Store.put(Key, dynamic("value of record " + std::to_string(Index) + " long enough for heap"));
+    }
+    Store.sync();
+  }
+
+  run("store/open+find/100k", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic_store Store(Path);
+      std::int64_t Result = Store.at("key/12345").get<std::int64_t>();
+      keep(Result);
+    }
+  });
+
+  dynamic_store Store(Path);
+  std::vector<std::string> Keys;
+  for (std::size_t Index = 0; Index < 1024; ++Index) Keys.push_back("key/" + std::to_string(Index * 97 % Records));
+  run("store/find", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic_view Result = Store.at(Keys[Index % Keys.size()]);
+      keep(Result);
+    }
+  });
+  run("store/put/update", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) Store.put(Keys[Index % Keys.size()], dynamic(std::int64_t(Index)));
+  });
+  std::filesystem::remove(Path);
+}
+
+//! Powers of two up to configured number of threads, and the number itself
+std::vector<unsigned> threadCounts() {
+  std::vector<unsigned> Counts;
+  for (unsigned Threads = 1; Threads < Settings.Threads; Threads *= 2) Counts.push_back(Threads);
+  Counts.push_back(Settings.Threads);
+  return Counts;
+}
+
+void benchmarkConcurrent() {
+  concurrent_dynamic Short(dynamic(std::int64_t(42))), Long(dynamic(std::string(256, 'x')));
+  for (unsigned Threads : threadCounts()) {
+    run("concurrent/load/int64/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        dynamic Result = Short.load();
+        keep(Result);
+      }
+    }, Threads);
+    run("concurrent/read/string/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        std::size_t Result = Long.read([](const dynamic & Value) {return Value.size();});
+        keep(Result);
+      }
+    }, Threads);
+  }
+  run("concurrent/store/int64", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) Short.store(dynamic(static_cast<std::int64_t>(Index)));
+  });
+}
+
+//! Classes of factory startup benchmark
+constexpr std::string_view PluginNames[] = {
+  "codec/png", "codec/jpeg", "codec/gif", "codec/webp", "codec/tiff", "codec/bmp", "codec/avif", "codec/heif",
+  "filter/blur", "filter/sharpen", "filter/scale", "filter/rotate", "filter/crop", "filter/invert", "filter/gamma", "filter/noise",
+};
+
+template <std::size_t... Index>
+constexpr auto staticPlugins(std::index_sequence<Index...>) {
+  return dynamic_factory<base>::MakeStaticRegistry(dynamic_factory<base>::StaticClass<plugin>(PluginNames[Index])...);
+}
+
+constexpr auto StaticPlugins = staticPlugins(std::make_index_sequence<std::size(PluginNames)>());
+
+void benchmarkFactory() {
+  // - Startup: runtime registration against static registry
+  run("factory/startup/RegisterClass x16", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic_factory<base> Factory;
+      for (std::string_view Name : PluginNames) Factory.RegisterClass<plugin>(Name);
+      keep(Factory);
+    }
+  });
+  run("factory/startup/static x16", [&](std::size_t Iterations) {
+    for (std::size_t Index = 0; Index < Iterations; ++Index) {
+      dynamic_factory<base> Factory(StaticPlugins);
+      keep(Factory);
+    }
+  });
+  {
+    dynamic_factory<base> Runtime, Static(StaticPlugins);
+    for (std::string_view Name : PluginNames) Runtime.RegisterClass<plugin>(Name);
+    run("factory/HasClass/runtime", [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Runtime.HasClass(PluginNames[Index % 16]); keep(Result);}
+    });
+    run("factory/HasClass/static", [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {bool Result = Static.HasClass(PluginNames[Index % 16]); keep(Result);}
+    });
+  }
+
+  dynamic_factory<base> Factory;
+  Factory.RegisterClass<plugin>("plugin");
+  for (int Index = 0; Index < 64; ++Index) Factory.RegisterClass<plugin>("plugin " + std::to_string(Index));
+  const std::string Name = "plugin 32";
+  const dynamic_factory<base>::ClassHandle Handle = Factory.Resolve(Name);
+  for (unsigned Threads : threadCounts()) {
+    run("factory/CreateInstance/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        base * Result = Factory.CreateInstance(Name);
+        keep(Result);
+        delete Result;
+      }
+    }, Threads);
+    run("factory/CreateInstance(handle)/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        base * Result = Factory.CreateInstance(Handle);
+        keep(Result);
+        delete Result;
+      }
+    }, Threads);
+    run("factory/CreatePooledInstance(handle)/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        dynamic_factory<base>::InstancePtr Result = Factory.CreatePooledInstance(Handle);
+        keep(Result);
+      }
+    }, Threads);
+    run("factory/CreateInstances(handle,64)/threads:" + std::to_string(Threads), [&](std::size_t Iterations) {
+      for (std::size_t Index = 0; Index < Iterations; ++Index) {
+        dynamic_factory<base>::InstanceArray Result = Factory.CreateInstances(Handle, 64);
+        keep(Result);
+      }
+    }, Threads);
+  }
+}
+
+}
+
+int main(int argc, char ** argv) {
+  for (int Index = 1; Index < argc; ++Index) {
+    std::string Argument = argv[Index];
+    if (Argument == "--filter" && Index + 1 < argc)       Settings.Filter = argv[++Index];
+    else if (Argument == "--threads" && Index + 1 < argc) Settings.Threads = std::max(1, std::atoi(argv[++Index]));
+    else if (Argument == "--repeat" && Index + 1 < argc)  Settings.Repeat = std::max(1, std::atoi(argv[++Index]));
+    else if (Argument == "--csv")                         Settings.Csv = true;
+    else {
+      std::fprintf(stderr, "Usage: %s [--filter TEXT] [--threads N] [--repeat N] [--csv]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::printf("sizeof(dynamic) = %zu bytes, inline capacity = %zu bytes\n", sizeof(dynamic), dynamic::buffer::inline_capacity);
+  if (Settings.Csv) std::printf("benchmark,ns/op,allocs/op,bytes/op\n");
+  else std::printf("%-48s %12s %12s %14s\n", "benchmark", "ns/op", "allocs/op", "heap bytes/op");
+
+  benchmarkConstruction();
+  benchmarkCasts();
+  benchmarkBatch();
+  benchmarkText();
+  benchmarkComparison();
+  benchmarkCopy();
+  benchmarkJson();
+  benchmarkStore();
+  benchmarkConcurrent();
+  benchmarkFactory();
+
+  // - Counters of the whole run when built with DYNAMIC_STATISTICS
+  if (dynamic::statistics::enabled) std::printf("\n%s", dynamic::statistics::current().dump().c_str());
+  return 0;
+}
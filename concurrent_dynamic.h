@@ -0,0 +1,168 @@
+/*
+ * CONCURRENT_DYNAMIC is dynamic value shared between threads
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include "dynamic.h"
+#include "hazard_domain.h"
+
+/**
+ * @brief Dynamic value which can be read and written from many threads
+ *
+ * Values fitting into inline storage of dynamic are kept in the cell itself under a sequence
+ * lock: readers copy the words and retry if a writer was active, no shared memory is written
+ * on read. Larger values, Arrays, Objects and interned Strings are kept in immutable heap
+ * payloads, readers protect them with hazard pointers and writers retire replaced payloads.
+ * Writers are serialized by the sequence word.
+ */
+class alignas(64) concurrent_dynamic {
+public:
+  //! Number of bytes stored in the cell itself
+  static constexpr std::size_t inline_capacity = dynamic::buffer::inline_capacity;
+
+  concurrent_dynamic() : _Sequence(0), _Header(0), _Heap(nullptr) {
+    for (std::atomic<std::uint64_t> & Word : _Words) Word.store(0, std::memory_order_relaxed);
+  }
+  concurrent_dynamic(const dynamic & Value) : concurrent_dynamic() {store(Value);}
+  concurrent_dynamic(dynamic && Value) : concurrent_dynamic() {store(std::move(Value));}
+
+  //! Destructor, must not run concurrently with readers
+  ~concurrent_dynamic() {
+    delete _Heap.load(std::memory_order_relaxed);
+  }
+
+  void operator = (const dynamic & Value)  {store(Value);}
+  void operator = (dynamic && Value)       {store(std::move(Value));}
+
+  //! Get copy of stored value
+  operator dynamic() const {return load();}
+
+  //! Get copy of stored value
+  dynamic load() const {
+    hazard_domain::guard Guard(true);
+    auto Copy = [](const dynamic & Value) {return Value;};
+    return access(Guard, Copy);
+  }
+
+  //! Call function with consistent snapshot of stored value, large values are passed without copying
+  template <typename Function>
+  auto read(Function && Reader) const -> decltype(Reader(std::declval<const dynamic&>())) {
+    hazard_domain::guard Guard;
+    if (Guard.reserved()) return Reader(load());
+    return access(Guard, Reader);
+  }
+
+  //! Store new value
+  void store(const dynamic & Value) {
+    if (Value.size() <= inline_capacity && !Value.value().is_container() && !Value.value().is_interned()) publish(Value, nullptr);
+    else publish(Value, new payload(dynamic(Value)));
+  }
+
+  //! Store new value, large payload is taken over without copying
+  void store(dynamic && Value) {
+    if (Value.size() <= inline_capacity && !Value.value().is_container() && !Value.value().is_interned()) publish(Value, nullptr);
+    else publish(Value, new payload(std::move(Value)));
+  }
+
+  //! Get number of stores since construction
+  std::uint64_t version() const {
+    return _Sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+private:
+  concurrent_dynamic(const concurrent_dynamic&);
+  concurrent_dynamic& operator = (const concurrent_dynamic&);
+
+  //! Heap payload of large value
+  struct payload : public hazard_domain::node {
+    explicit payload(dynamic && Source) : Value(std::move(Source)) {}
+    dynamic Value;
+  };
+
+  //! Number of inline words
+  static constexpr std::size_t words = (inline_capacity + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  //! Header layout: stored type, heap flag and inline size
+  static constexpr std::uint64_t heap_flag  = std::uint64_t(1) << 8;
+  static constexpr unsigned      size_shift = 16;
+
+  //! Read consistent snapshot and pass it to function
+  template <typename Function>
+  auto access(hazard_domain::guard & Guard, Function & Reader) const -> decltype(Reader(std::declval<const dynamic&>())) {
+    std::uint64_t Header, Words[words];
+    payload * Heap;
+    for (;;) {
+      std::uint64_t Sequence = _Sequence.load(std::memory_order_acquire);
+      if (Sequence & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      Header = _Header.load(std::memory_order_relaxed);
+      for (std::size_t Index = 0; Index < words; ++Index) Words[Index] = _Words[Index].load(std::memory_order_relaxed);
+      Heap = nullptr;
+      if (Header & heap_flag) {
+        Heap = _Heap.load(std::memory_order_relaxed);
+        Guard.protect(Heap);
+      }
+      // - Validate snapshot, also proves protected payload was not yet retired
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_Sequence.load(std::memory_order_seq_cst) == Sequence) break;
+    }
+    if (Heap) return Reader(static_cast<const dynamic&>(Heap->Value));
+
+    dynamic Value;
+    std::size_t Size = static_cast<std::size_t>(Header >> size_shift);
+    if (Size) {
+      Value.resize(Size);
+      std::memcpy(Value.data(), Words, Size);
+    }
+    Value.setType(static_cast<dynamic::Type>(Header & 0xFF));
+    return Reader(static_cast<const dynamic&>(Value));
+  }
+
+  //! Replace stored value, inline values are copied from given dynamic
+  void publish(const dynamic & Value, payload * Heap) {
+    std::uint64_t Header = static_cast<std::uint64_t>(Value.type());
+    std::uint64_t Words[words] = {};
+    if (Heap) Header |= heap_flag;
+    else {
+      Header |= static_cast<std::uint64_t>(Value.size()) << size_shift;
+      if (Value.size()) std::memcpy(Words, Value.data(), Value.size());
+    }
+
+    // - Enter write section
+    std::uint64_t Sequence = _Sequence.load(std::memory_order_relaxed);
+    for (;;) {
+      if (Sequence & 1) {
+        std::this_thread::yield();
+        Sequence = _Sequence.load(std::memory_order_relaxed);
+      } else if (_Sequence.compare_exchange_weak(Sequence, Sequence + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _Header.store(Header, std::memory_order_relaxed);
+    for (std::size_t Index = 0; Index < words; ++Index) _Words[Index].store(Words[Index], std::memory_order_relaxed);
+    payload * Previous = _Heap.exchange(Heap, std::memory_order_relaxed);
+
+    _Sequence.store(Sequence + 2, std::memory_order_release);
+    if (Previous) hazard_domain::retire(Previous);
+  }
+
+  //! Sequence lock, odd while writer is active
+  std::atomic<std::uint64_t>  _Sequence;
+
+  //! Stored type, heap flag and inline size
+  std::atomic<std::uint64_t>  _Header;
+
+  //! Inline payload
+  std::atomic<std::uint64_t>  _Words[words];
+
+  //! Heap payload of large value
+  std::atomic<payload*>       _Heap;
+};
@@ -9,9 +9,26 @@
 #include <memory>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 #include <list>
 #include <vector>
+#include <atomic>
+#include <memory_resource>
+#include <charconv>
+#include <limits>
+#include <cctype>
+#include <type_traits>
+#include <string_view>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <stdexcept>
+#include <optional>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
 #define __WITH_DYNAMIC_TYPE__
 
 // - Autodetect UUIDPP capability
@@ -19,6 +36,16 @@
   #define __DYNAMIC__WITH_UUIDPP__
 #endif
 
+// - Instrumentation counters, enabled by DYNAMIC_STATISTICS, latency histograms by DYNAMIC_STATISTICS_LATENCY
+#ifdef DYNAMIC_STATISTICS
+  #include <chrono>
+  #include <exception>
+  #define __DYNAMIC__WITH_STATISTICS__
+  #ifdef DYNAMIC_STATISTICS_LATENCY
+    #define __DYNAMIC__WITH_STATISTICS_LATENCY__
+  #endif
+#endif
+
 /**
  * @author Andrey Bezborodov <andrey@wavecon.ru>
  * @brief Dynamic type implementation
@@ -39,6 +66,10 @@ public:
     String,
     //! Binary data
     Binary,
+    //! Array of values
+    Array,
+    //! Object, values by String keys
+    Object,
 
   #ifdef __DYNAMIC__WITH_UUIDPP__
     //! UUID
@@ -46,10 +77,975 @@ public:
   #endif
 
   };
+
+  //! Stored type together with data width, UUID is reported as Binary
+  enum class Kind : std::uint8_t {
+    Undefined,
+    Int8, Int16, Int32, Int64,
+    UInt8, UInt16, UInt32, UInt64,
+    Float32, Float64,
+    String,
+    Binary,
+    Array,
+    Object,
+    //! Numeric type with unsupported width
+    Invalid,
+    Count
+  };
+
+  //! Heap capacity retention policy
+  enum class CapacityPolicy {
+    //! Release or reallocate heap storage whenever it does not match the new size
+    Shrink,
+    //! Keep heap storage while new data fits into it
+    Keep,
+    //! Keep heap storage while its capacity does not exceed high water mark
+    HighWaterMark,
+  };
+
+  /**
+   * @brief Instrumentation counters of conversions, heap allocations and copies
+   *
+   * Compiled in only when DYNAMIC_STATISTICS is defined (consistently in all translation units),
+   * otherwise all hooks are empty and current() returns zeros. Every thread counts into its own
+   * counters without locking, current() sums counters of running and finished threads since the
+   * last reset(). Conversions are keyed by (source Type, target type) and count failures, that is
+   * std::bad_cast thrown by casts or empty try_cast() result. With DYNAMIC_STATISTICS_LATENCY
+   * every conversion is timed into histogram of power of two nanosecond buckets.
+   */
+  class statistics {
+  public:
+    //! Conversion target
+    enum class Target : std::uint8_t {
+      Int8, Int16, Int32, Int64,
+      UInt8, UInt16, UInt32, UInt64,
+      Float, Double, Bool,
+      //! operator std::string()
+      String,
+      //! format_to()
+      Text,
+      //! operator std::vector<std::uint8_t>()
+      Binary,
+      Count
+    };
+
+    //! Number of source types and conversion targets
+    #ifdef __DYNAMIC__WITH_UUIDPP__
+    static constexpr std::size_t sources = static_cast<std::size_t>(Type::UUID) + 1;
+    #else
+    static constexpr std::size_t sources = static_cast<std::size_t>(Type::Object) + 1;
+    #endif
+    static constexpr std::size_t targets = static_cast<std::size_t>(Target::Count);
+
+    //! Number of latency buckets, bucket N counts conversions shorter than 2^N ns, the last one all longer
+    static constexpr std::size_t buckets = 24;
+
+    #ifdef __DYNAMIC__WITH_STATISTICS__
+    static constexpr bool enabled = true;
+    #else
+    static constexpr bool enabled = false;
+    #endif
+
+    //! Counter values
+    struct snapshot {
+      std::uint64_t Conversions[sources][targets] = {};
+      std::uint64_t Failures[sources][targets]    = {};
+      #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+      std::uint64_t Latency[sources][targets][buckets] = {};
+      #endif
+
+      //! Heap blocks allocated by buffers and their total size
+      std::uint64_t Allocations     = 0;
+      std::uint64_t AllocatedBytes  = 0;
+
+      //! Heap payloads moved to new block by resize()
+      std::uint64_t Reallocations   = 0;
+
+      //! Copy and move assignments, copy construction included
+      std::uint64_t Copies          = 0;
+      std::uint64_t Moves           = 0;
+
+      //! Exceptions thrown by casts
+      std::uint64_t Exceptions      = 0;
+
+      //! Format counters as text, one line per counter, conversions never run are left out
+      std::string dump() const {
+        std::ostringstream Output;
+        Output << "allocations " << Allocations << " (" << AllocatedBytes << " bytes), reallocations " << Reallocations << "\n"
+               << "copies " << Copies << ", moves " << Moves << "\n"
+               << "exceptions " << Exceptions << "\n";
+        for (std::size_t Source = 0; Source < sources; ++Source) {
+          for (std::size_t Into = 0; Into < targets; ++Into) {
+            if (!Conversions[Source][Into]) continue;
+            Output << sourceName(Source) << "->" << targetName(Into) << " " << Conversions[Source][Into];
+            if (Failures[Source][Into]) Output << ", failed " << Failures[Source][Into];
+            #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+            Output << ", p50 <" << percentile(Latency[Source][Into], Conversions[Source][Into], 50)
+                   << "ns, p99 <" << percentile(Latency[Source][Into], Conversions[Source][Into], 99) << "ns";
+            #endif
+            Output << "\n";
+          }
+        }
+        return Output.str();
+      }
+
+    private:
+      static const char * sourceName(std::size_t Source) {
+        static constexpr const char * Names[] = {"Undefined", "SignedInt", "UnsignedInt", "Float", "String", "Binary", "Array", "Object", "UUID"};
+        return Names[Source];
+      }
+
+      static const char * targetName(std::size_t Into) {
+        static constexpr const char * Names[] = {"int8", "int16", "int32", "int64", "uint8", "uint16", "uint32", "uint64",
+                                                 "float", "double", "bool", "string", "text", "binary"};
+        return Names[Into];
+      }
+
+      //! Upper bound of bucket holding given percentile
+      static std::uint64_t percentile(const std::uint64_t (&Histogram)[buckets], std::uint64_t Total, std::uint64_t Percent) {
+        std::uint64_t Seen = 0;
+        for (std::size_t Bucket = 0; Bucket + 1 < buckets; ++Bucket) {
+          Seen += Histogram[Bucket];
+          if (Seen * 100 >= Total * Percent) return std::uint64_t(1) << Bucket;
+        }
+        return std::uint64_t(1) << (buckets - 1);
+      }
+    };
+
+    //! Get counters of all threads since the last reset
+    static snapshot current() {
+      snapshot Result;
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      registry & Registry = shared();
+      std::lock_guard<std::mutex> Lock(Registry.Mutex);
+      Result = Registry.Finished;
+      for (const counters * Counters : Registry.Threads) Counters->addTo(Result);
+      subtract(Result, Registry.Baseline);
+      #endif
+      return Result;
+    }
+
+    //! Start counting from zero
+    static void reset() {
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      registry & Registry = shared();
+      std::lock_guard<std::mutex> Lock(Registry.Mutex);
+      Registry.Baseline = Registry.Finished;
+      for (const counters * Counters : Registry.Threads) Counters->addTo(Registry.Baseline);
+      #endif
+    }
+
+    /**
+     * @brief Scope of single conversion
+     *
+     * Counts conversion when created, failure when fail() is called or when it is left by exception.
+     */
+    class conversion {
+    public:
+    #ifdef __DYNAMIC__WITH_STATISTICS__
+      conversion(Type Source, Target Into)
+        : _Source(static_cast<std::size_t>(Source)), _Into(static_cast<std::size_t>(Into)), _Exceptions(std::uncaught_exceptions()) {
+        counters & Counters = local();
+        bump(Counters.Conversions[_Source][_Into]);
+        #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+        _Start = std::chrono::steady_clock::now();
+        #endif
+      }
+
+      ~conversion() {
+        counters & Counters = local();
+        if (std::uncaught_exceptions() > _Exceptions) {
+          bump(Counters.Failures[_Source][_Into]);
+          bump(Counters.Exceptions);
+        }
+        #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+        std::uint64_t Elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _Start).count());
+        std::size_t   Bucket  = 0;
+        while (Bucket + 1 < buckets && (std::uint64_t(1) << Bucket) <= Elapsed) ++Bucket;
+        bump(Counters.Latency[_Source][_Into][Bucket]);
+        #endif
+      }
+
+      //! Count failure reported without exception
+      void fail() {
+        bump(local().Failures[_Source][_Into]);
+      }
+
+    private:
+      conversion(const conversion&);
+      conversion& operator = (const conversion&);
+
+      std::size_t _Source;
+      std::size_t _Into;
+      int         _Exceptions;
+      #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+      std::chrono::steady_clock::time_point _Start;
+      #endif
+    #else
+      conversion(Type, Target) {}
+      void fail() {}
+    #endif
+    };
+
+    //! Get conversion target of numeric type
+    template <typename T>
+    static constexpr Target target() {
+      if constexpr (std::is_same<T, bool>::value)         return Target::Bool;
+      else if constexpr (std::is_floating_point<T>::value) return sizeof(T) == sizeof(float) ? Target::Float : Target::Double;
+      else {
+        constexpr std::size_t Width = sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3;
+        return static_cast<Target>((std::is_signed<T>::value ? 0 : 4) + Width);
+      }
+    }
+
+    //! Count heap block allocation
+    static void allocated(std::size_t Bytes) {
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      counters & Counters = local();
+      bump(Counters.Allocations);
+      bump(Counters.AllocatedBytes, Bytes);
+      #else
+      (void)Bytes;
+      #endif
+    }
+
+    //! Count heap payload moved to new block
+    static void reallocated() {
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      bump(local().Reallocations);
+      #endif
+    }
+
+    //! Count copy assignment
+    static void copied() {
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      bump(local().Copies);
+      #endif
+    }
+
+    //! Count move assignment
+    static void moved() {
+      #ifdef __DYNAMIC__WITH_STATISTICS__
+      bump(local().Moves);
+      #endif
+    }
+
+  #ifdef __DYNAMIC__WITH_STATISTICS__
+  private:
+    typedef std::atomic<std::uint64_t> counter;
+
+    //! Counters of single thread, written by owning thread only
+    struct counters {
+      counter Conversions[sources][targets] = {};
+      counter Failures[sources][targets]    = {};
+      #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+      counter Latency[sources][targets][buckets] = {};
+      #endif
+      counter Allocations{0}, AllocatedBytes{0}, Reallocations{0}, Copies{0}, Moves{0}, Exceptions{0};
+
+      //! Add counter values to snapshot
+      void addTo(snapshot & Result) const {
+        auto Add = [](std::uint64_t & Total, const counter & Value) {Total += Value.load(std::memory_order_relaxed);};
+        for (std::size_t Source = 0; Source < sources; ++Source) {
+          for (std::size_t Into = 0; Into < targets; ++Into) {
+            Add(Result.Conversions[Source][Into], Conversions[Source][Into]);
+            Add(Result.Failures[Source][Into], Failures[Source][Into]);
+            #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+            for (std::size_t Bucket = 0; Bucket < buckets; ++Bucket) Add(Result.Latency[Source][Into][Bucket], Latency[Source][Into][Bucket]);
+            #endif
+          }
+        }
+        Add(Result.Allocations, Allocations);
+        Add(Result.AllocatedBytes, AllocatedBytes);
+        Add(Result.Reallocations, Reallocations);
+        Add(Result.Copies, Copies);
+        Add(Result.Moves, Moves);
+        Add(Result.Exceptions, Exceptions);
+      }
+    };
+
+    //! Counters of calling thread registered for the lifetime of the thread
+    struct thread_counters {
+      thread_counters() : Counters(new counters) {
+        registry & Registry = shared();
+        std::lock_guard<std::mutex> Lock(Registry.Mutex);
+        Registry.Threads.push_back(Counters);
+      }
+
+      ~thread_counters() {
+        registry & Registry = shared();
+        std::lock_guard<std::mutex> Lock(Registry.Mutex);
+        Counters->addTo(Registry.Finished);
+        Registry.Threads.erase(std::find(Registry.Threads.begin(), Registry.Threads.end(), Counters));
+        delete Counters;
+      }
+
+      counters * Counters;
+    };
+
+    //! Get counters of calling thread
+    static counters & local() {
+      thread_local thread_counters Thread;
+      return *Thread.Counters;
+    }
+
+    //! Increment counter owned by calling thread
+    static void bump(counter & Counter, std::uint64_t Value = 1) {
+      Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+    }
+
+    //! Subtract counters of given snapshot
+    static void subtract(snapshot & Result, const snapshot & Base) {
+      for (std::size_t Source = 0; Source < sources; ++Source) {
+        for (std::size_t Into = 0; Into < targets; ++Into) {
+          Result.Conversions[Source][Into] -= Base.Conversions[Source][Into];
+          Result.Failures[Source][Into]    -= Base.Failures[Source][Into];
+          #ifdef __DYNAMIC__WITH_STATISTICS_LATENCY__
+          for (std::size_t Bucket = 0; Bucket < buckets; ++Bucket) Result.Latency[Source][Into][Bucket] -= Base.Latency[Source][Into][Bucket];
+          #endif
+        }
+      }
+      Result.Allocations    -= Base.Allocations;
+      Result.AllocatedBytes -= Base.AllocatedBytes;
+      Result.Reallocations  -= Base.Reallocations;
+      Result.Copies         -= Base.Copies;
+      Result.Moves          -= Base.Moves;
+      Result.Exceptions     -= Base.Exceptions;
+    }
+
+    //! Counters of running threads and of finished ones
+    struct registry {
+      std::mutex              Mutex;
+      std::vector<counters*>  Threads;
+      snapshot                Finished;
+
+      //! Counter values at the last reset
+      snapshot                Baseline;
+    };
+
+    //! Get registry of thread counters
+    static registry & shared() {
+      static registry Registry;
+      return Registry;
+    }
+  #endif
+  };
+
+  /**
+   * @brief Raw data buffer with inline storage for small payloads
+   *
+   * Payloads up to inline_capacity bytes (all numeric types, UUIDs, short strings and binaries)
+   * are kept inside the object itself, larger payloads fall back to a heap block. A heap block
+   * either owns raw storage or an adopted std::string / std::vector moved in by the caller.
+   * Heap blocks are allocated from the buffer's memory resource (default resource if none given).
+   * Heap payloads of at least shared_threshold bytes are shared between copies by reference count
+   * and cloned on first mutable access, so copying large String and Binary values is O(1).
+   * Array and Object values keep their container in a heap block, such block is always shared
+   * between copies and cloned element by element on first mutable access. Container must not be
+   * assigned into its own element directly, the block would reference itself; assign a copy.
+   * Interned payloads are immutable heap blocks registered in process wide intern table, one per
+   * distinct content. They are always shared between copies, even short ones, and copied into own
+   * storage on first mutable access. Block leaves the table with its last reference.
+   * Heap blocks other than interned ones are shared or moved only between buffers with equal memory
+   * resources, copy into buffer with other resource gets own storage, containers cloned element by
+   * element, so copy outlives arena it was made from.
+   */
+  class buffer {
+  public:
+    //! Maximum payload size stored without heap allocation
+    static constexpr std::size_t inline_capacity = 24;
+
+    //! Minimum heap payload size shared between copies instead of being copied
+    static constexpr std::size_t shared_threshold = 1024;
+
+    typedef std::uint8_t        value_type;
+    typedef std::uint8_t*       iterator;
+    typedef const std::uint8_t* const_iterator;
+
+    explicit buffer(std::pmr::memory_resource * Resource = nullptr)
+      : _Heap{nullptr, nullptr}, _Size(0), _Capacity(inline_capacity), _Resource(Resource), _Policy(CapacityPolicy::HighWaterMark) {}
+    buffer(const buffer & Other)
+      : _Heap{nullptr, nullptr}, _Size(0), _Capacity(inline_capacity), _Resource(nullptr), _Policy(Other._Policy) {*this = Other;}
+    buffer(buffer && Other) noexcept
+      : _Heap{nullptr, nullptr}, _Size(0), _Capacity(inline_capacity), _Resource(Other._Resource), _Policy(Other._Policy) {steal(Other);}
+    ~buffer() {release();}
+
+    //! Copy assignment, large heap payloads from the same memory resource are shared until one of the copies is modified
+    buffer & operator = (const buffer & Other) {
+      if (this == &Other) return *this;
+      if (Other.is_inline() || (Other._Size < shared_threshold && !Other.is_container() && !Other.is_interned())) {
+        assign(Other.begin(), Other.end());
+        return *this;
+      }
+      if (!can_share(Other)) {
+        copy(Other);
+        return *this;
+      }
+      Other._Heap.Block->References.fetch_add(1, std::memory_order_relaxed);
+      release();
+      _Heap     = Other._Heap;
+      _Size     = Other._Size;
+      _Capacity = Other._Capacity;
+      return *this;
+    }
+
+    //! Move assignment, heap storage is only taken over from the same memory resource
+    buffer & operator = (buffer && Other) {
+      if (this == &Other) return *this;
+      if (Other.is_inline() || can_share(Other)) {
+        release();
+        steal(Other);
+      } else {
+        copy(Other);
+      }
+      return *this;
+    }
+
+  public:
+    //! Get size of stored data
+    std::size_t size() const {return _Size;}
+
+    //! Get allocated capacity
+    std::size_t capacity() const {return _Capacity;}
+
+    //! Check is buffer empty
+    bool empty() const {return !_Size;}
+
+    //! Check is data stored inline
+    bool is_inline() const {return _Capacity <= inline_capacity;}
+
+    //! Check is heap payload shared with other buffers
+    bool is_shared() const {return !is_inline() && _Heap.Block->References.load(std::memory_order_acquire) > 1;}
+
+    //! Check is container of values stored instead of raw data
+    bool is_container() const {return !is_inline() && _Heap.Block->Clone;}
+
+    //! Check is payload interned
+    bool is_interned() const {return !is_inline() && _Heap.Block->Interned;}
+
+    //! Access raw data
+    const std::uint8_t * data() const {return is_inline() ? _Inline : _Heap.Data;}
+
+    //! Access raw data, shared payload is cloned first
+    std::uint8_t * data() {
+      if (is_inline()) return _Inline;
+      if (is_shared() || is_interned()) {
+        unshare();
+        if (is_inline()) return _Inline;
+      }
+      // - Data may be modified through returned pointer
+      _Heap.Block->Hash.store(0, std::memory_order_relaxed);
+      return _Heap.Data;
+    }
+
+    const_iterator begin() const  {return data();}
+    const_iterator end() const    {return data() + _Size;}
+    iterator begin()              {return data();}
+    iterator end()                {return data() + _Size;}
+
+    const std::uint8_t & operator [] (std::size_t Index) const {return data()[Index];}
+    std::uint8_t & operator [] (std::size_t Index)             {return data()[Index];}
+
+    //! Get memory resource used for heap storage
+    std::pmr::memory_resource * resource() const {
+      return _Resource ? _Resource : std::pmr::get_default_resource();
+    }
+
+    //! Get capacity retention policy
+    CapacityPolicy policy() const {return _Policy;}
+
+    //! Set capacity retention policy, applied on next resize
+    void set_policy(CapacityPolicy Policy) {_Policy = Policy;}
+
+    //! Get heap capacity limit for CapacityPolicy::HighWaterMark
+    static std::size_t high_water_mark() {return _HighWaterMark.load(std::memory_order_relaxed);}
+
+    //! Set heap capacity limit for CapacityPolicy::HighWaterMark
+    static void set_high_water_mark(std::size_t Size) {_HighWaterMark.store(Size, std::memory_order_relaxed);}
+
+    //! Resize buffer, existing data is preserved up to the new size
+    void resize(std::size_t NewSize) {
+      if (NewSize <= _Capacity && retain(NewSize)) {
+        // - Current storage is kept, cached hash no longer matches
+        if (!is_inline()) _Heap.Block->Hash.store(0, std::memory_order_relaxed);
+      } else if (NewSize <= inline_capacity) {
+        // - Move back to inline storage
+        block * Block = _Heap.Block;
+        std::memcpy(_Inline, _Heap.Data, std::min(_Size, NewSize));
+        unref(Block);
+        _Capacity = inline_capacity;
+      } else {
+        // - Reallocate heap storage to the exact size
+        if (!is_inline()) statistics::reallocated();
+        block * Block = allocate(resource(), NewSize);
+        std::memcpy(block::payload(Block), static_cast<const buffer&>(*this).data(), std::min(_Size, NewSize));
+        release();
+        _Heap.Block = Block;
+        _Heap.Data  = block::payload(Block);
+        _Capacity   = NewSize;
+      }
+      _Size = NewSize;
+    }
+
+    //! Replace content with given range
+    template <typename Iterator>
+    void assign(Iterator First, Iterator Last) {
+      resize(static_cast<std::size_t>(std::distance(First, Last)));
+      std::copy(First, Last, data());
+    }
+
+    //! Take over storage of given container without copying the payload
+    template <typename Container>
+    void adopt(Container && Value) {
+      typedef adopted<typename std::decay<Container>::type> Adopted;
+
+      // - Small payloads are cheaper to keep inline
+      if (Value.size() <= inline_capacity) {
+        assign(Value.begin(), Value.end());
+        return;
+      }
+      std::pmr::memory_resource * Resource = resource();
+      statistics::allocated(sizeof(Adopted));
+      Adopted * Block = new (Resource->allocate(sizeof(Adopted), alignof(Adopted))) Adopted(Resource, std::move(Value));
+      release();
+      _Heap.Block = Block;
+      _Heap.Data  = reinterpret_cast<std::uint8_t*>(&Block->Value[0]);
+      _Size       = Block->Value.size();
+      _Capacity   = _Size;
+    }
+
+    //! Store container of values, raw data size becomes zero
+    template <typename Container>
+    void store(Container && Value) {
+      typedef owned<typename std::decay<Container>::type> Owned;
+      std::pmr::memory_resource * Resource = resource();
+      statistics::allocated(sizeof(Owned));
+      Owned * Block = new (Resource->allocate(sizeof(Owned), alignof(Owned))) Owned(Resource, std::move(Value));
+      release();
+      _Heap.Block = Block;
+      _Heap.Data  = block::payload(Block);
+      _Size       = 0;
+      _Capacity   = container_capacity;
+    }
+
+    //! Access stored container, buffer must hold container of given type
+    template <typename Container>
+    const Container & container() const {
+      return static_cast<const owned<Container>*>(_Heap.Block)->Value;
+    }
+
+    //! Access stored container, shared container is cloned first
+    template <typename Container>
+    Container & container() {
+      if (is_shared()) unshare();
+      return static_cast<owned<Container>*>(_Heap.Block)->Value;
+    }
+
+    //! Remove all data
+    void clear() {
+      resize(0);
+    }
+
+    //! Get cached hash of heap stored payload, zero if not cached
+    std::uint64_t cached_hash() const {
+      return is_inline() ? 0 : _Heap.Block->Hash.load(std::memory_order_relaxed);
+    }
+
+    //! Cache hash of heap stored payload
+    void cache_hash(std::uint64_t Hash) const {
+      if (!is_inline()) _Heap.Block->Hash.store(Hash, std::memory_order_relaxed);
+    }
+
+    //! Replace content with interned copy of given data, hash of the data is kept in the block
+    void intern(const std::uint8_t * Data, std::size_t Size, std::uint64_t Hash) {
+      block * Block = interned().acquire(Data, Size, Hash);
+      release();
+      _Heap.Block = Block;
+      _Heap.Data  = block::payload(Block);
+      _Size       = Size;
+      _Capacity   = std::max(Size, inline_capacity + 1);
+    }
+
+    //! Check do both buffers reference the same heap block
+    bool same_block(const buffer & Other) const {
+      return !is_inline() && !Other.is_inline() && _Heap.Block == Other._Heap.Block;
+    }
+
+    //! Get number of distinct interned payloads
+    static std::size_t interned_count() {
+      return interned().size();
+    }
+
+  private:
+    //! Heap storage block
+    struct block {
+      block(void (*ReleaseFunction)(block *), std::pmr::memory_resource * Source, std::size_t Size)
+        : Release(ReleaseFunction), Clone(nullptr), Resource(Source), Capacity(Size), References(1), Hash(0), Interned(false) {}
+
+      //! Release block together with its storage
+      void (*Release)(block *);
+
+      //! Copy block holding container of values, null for raw storage
+      block * (*Clone)(const block *, std::pmr::memory_resource *);
+
+      //! Memory resource block was allocated from
+      std::pmr::memory_resource * Resource;
+
+      //! Size of raw storage that follows block header
+      std::size_t Capacity;
+
+      //! Number of buffers referencing block
+      std::atomic<std::size_t> References;
+
+      //! Cached hash of payload, zero if not computed
+      mutable std::atomic<std::uint64_t> Hash;
+
+      //! Block is immutable and registered in intern table
+      bool Interned;
+
+      //! Get raw storage that follows block header
+      static std::uint8_t * payload(block * Block) {
+        return reinterpret_cast<std::uint8_t*>(Block + 1);
+      }
+    };
+
+    //! Heap storage block that owns adopted container
+    template <typename Container>
+    struct adopted : block {
+      adopted(std::pmr::memory_resource * Source, Container && Content) : block(&release, Source, 0), Value(std::move(Content)) {}
+
+      //! Destroy block and release its memory
+      static void release(block * Self) {
+        std::pmr::memory_resource * Resource = Self->Resource;
+        static_cast<adopted*>(Self)->~adopted();
+        Resource->deallocate(Self, sizeof(adopted), alignof(adopted));
+      }
+
+      //! Adopted container
+      Container Value;
+    };
+
+    //! Heap storage block that owns container of values
+    template <typename Container>
+    struct owned : block {
+      owned(std::pmr::memory_resource * Source, Container && Content) : block(&release, Source, 0), Value(std::move(Content)) {Clone = &clone;}
+
+      //! Destroy block and release its memory
+      static void release(block * Self) {
+        std::pmr::memory_resource * Resource = Self->Resource;
+        static_cast<owned*>(Self)->~owned();
+        Resource->deallocate(Self, sizeof(owned), alignof(owned));
+      }
+
+      //! Copy container into new block allocated from given memory resource
+      static block * clone(const block * Self, std::pmr::memory_resource * Resource) {
+        Container Copy(static_cast<const owned*>(Self)->Value, typename Container::allocator_type(Resource));
+        statistics::allocated(sizeof(owned));
+        return new (Resource->allocate(sizeof(owned), alignof(owned))) owned(Resource, std::move(Copy));
+      }
+
+      //! Owned container
+      Container Value;
+    };
+
+    //! Capacity reported by buffer holding container, marks heap storage without raw payload
+    static constexpr std::size_t container_capacity = inline_capacity + 1;
+
+    //! Allocate block with raw storage of given size
+    static block * allocate(std::pmr::memory_resource * Resource, std::size_t Size) {
+      statistics::allocated(sizeof(block) + Size);
+      return new (Resource->allocate(sizeof(block) + Size, alignof(block))) block([](block * Self) {
+        std::pmr::memory_resource * Source = Self->Resource;
+        std::size_t                 Bytes  = sizeof(block) + Self->Capacity;
+        Self->~block();
+        Source->deallocate(Self, Bytes, alignof(block));
+      }, Resource, Size);
+    }
+
+    /**
+     * @brief Concurrent table of interned blocks
+     *
+     * Sharded by hash, lookups of existing payload take shared lock of one shard. Block whose last
+     * reference is being dropped stays in the table until its release removes it, lookup meanwhile
+     * replaces it with new block.
+     */
+    class intern_table {
+    public:
+      //! Get referenced block with given content, new block is created if there is none
+      block * acquire(const std::uint8_t * Data, std::size_t Size, std::uint64_t Hash) {
+        shard & Shard = _Shards[Hash >> shard_shift];
+        key     Key{std::string_view(reinterpret_cast<const char*>(Data), Size), Hash};
+        {
+          std::shared_lock<std::shared_mutex> Lock(Shard.Mutex);
+          auto Found = Shard.Blocks.find(Key);
+          if (Found != Shard.Blocks.end() && try_reference(Found->second)) return Found->second;
+        }
+        std::unique_lock<std::shared_mutex> Lock(Shard.Mutex);
+        auto Found = Shard.Blocks.find(Key);
+        if (Found != Shard.Blocks.end()) {
+          if (try_reference(Found->second)) return Found->second;
+          Shard.Blocks.erase(Found);
+        }
+        block * Block = create(Data, Size, Hash);
+        Shard.Blocks.emplace(key{std::string_view(reinterpret_cast<const char*>(block::payload(Block)), Size), Hash}, Block);
+        return Block;
+      }
+
+      //! Remove released block unless it was already replaced
+      void remove(block * Block) {
+        shard & Shard = _Shards[Block->Hash.load(std::memory_order_relaxed) >> shard_shift];
+        std::unique_lock<std::shared_mutex> Lock(Shard.Mutex);
+        auto Found = Shard.Blocks.find(key{std::string_view(reinterpret_cast<const char*>(block::payload(Block)), Block->Capacity), Block->Hash.load(std::memory_order_relaxed)});
+        if (Found != Shard.Blocks.end() && Found->second == Block) Shard.Blocks.erase(Found);
+      }
+
+      //! Get number of blocks in table
+      std::size_t size() {
+        std::size_t Result = 0;
+        for (shard & Shard : _Shards) {
+          std::shared_lock<std::shared_mutex> Lock(Shard.Mutex);
+          Result += Shard.Blocks.size();
+        }
+        return Result;
+      }
+
+    private:
+      //! Number of shards is 2^(64 - shard_shift), shard is selected by top bits of hash
+      static constexpr unsigned shard_shift = 58;
+
+      //! Content of block with its hash
+      struct key {
+        std::string_view  Text;
+        std::uint64_t     Hash;
+
+        bool operator == (const key & Other) const {return Hash == Other.Hash && Text == Other.Text;}
+      };
+
+      struct key_hash {
+        std::size_t operator () (const key & Key) const {return static_cast<std::size_t>(Key.Hash);}
+      };
+
+      struct alignas(64) shard {
+        std::shared_mutex                             Mutex;
+        std::unordered_map<key, block*, key_hash>     Blocks;
+      };
+
+      //! Take reference to block unless its last reference is being dropped
+      static bool try_reference(block * Block) {
+        std::size_t References = Block->References.load(std::memory_order_relaxed);
+        while (References && !Block->References.compare_exchange_weak(References, References + 1, std::memory_order_relaxed)) {}
+        return References != 0;
+      }
+
+      //! Allocate interned block with copy of given data
+      static block * create(const std::uint8_t * Data, std::size_t Size, std::uint64_t Hash) {
+        std::pmr::memory_resource * Resource = std::pmr::new_delete_resource();
+        statistics::allocated(sizeof(block) + Size);
+        block * Block = new (Resource->allocate(sizeof(block) + Size, alignof(block))) block([](block * Self) {
+          interned().remove(Self);
+          std::size_t Bytes = sizeof(block) + Self->Capacity;
+          Self->~block();
+          std::pmr::new_delete_resource()->deallocate(Self, Bytes, alignof(block));
+        }, Resource, Size);
+        if (Size) std::memcpy(block::payload(Block), Data, Size);
+        Block->Hash.store(Hash, std::memory_order_relaxed);
+        Block->Interned = true;
+        return Block;
+      }
+
+      shard _Shards[std::size_t(1) << (64 - shard_shift)];
+    };
+
+    //! Get process wide intern table, never destroyed so blocks may be released during exit
+    static intern_table & interned() {
+      static intern_table * Table = new intern_table;
+      return *Table;
+    }
+
+    //! Check is current storage allowed to be kept for data of given size
+    bool retain(std::size_t NewSize) const {
+      if (is_inline()) return true;
+      if (is_shared() || is_container() || is_interned()) return false;
+      switch (_Policy) {
+        case CapacityPolicy::Shrink:        return NewSize == _Capacity;
+        case CapacityPolicy::Keep:          return true;
+        case CapacityPolicy::HighWaterMark: return _Capacity <= high_water_mark();
+      }
+      return false;
+    }
+
+    //! Check can heap block of other buffer be referenced, block must outlive its memory resource users
+    bool can_share(const buffer & Other) const {
+      // - Interned blocks are owned by process wide table, not by memory resource of any buffer
+      return Other._Heap.Block->Interned || *resource() == *Other._Heap.Block->Resource;
+    }
+
+    //! Copy heap payload of other buffer into own memory resource, containers are cloned element by element
+    void copy(const buffer & Other) {
+      if (!Other.is_container()) {
+        assign(Other.begin(), Other.end());
+        return;
+      }
+      block * Block = Other._Heap.Block->Clone(Other._Heap.Block, resource());
+      release();
+      _Heap.Block = Block;
+      _Heap.Data  = block::payload(Block);
+      _Size       = 0;
+      _Capacity   = container_capacity;
+    }
+
+    //! Take storage of other buffer, other buffer is left empty
+    void steal(buffer & Other) noexcept {
+      // - Fixed size copy of whole inline storage is cheaper than copy of the payload size
+      if (Other.is_inline()) std::memcpy(_Inline, Other._Inline, inline_capacity);
+      else _Heap = Other._Heap;
+      _Size           = Other._Size;
+      _Capacity       = Other._Capacity;
+      Other._Size     = 0;
+      Other._Capacity = inline_capacity;
+    }
+
+    //! Drop reference to heap block, block is released with the last reference
+    static void unref(block * Block) noexcept {
+      if (Block->References.fetch_sub(1, std::memory_order_acq_rel) == 1) Block->Release(Block);
+    }
+
+    //! Replace shared heap block with private copy
+    void unshare() {
+      block * Block;
+      if (_Heap.Block->Clone) Block = _Heap.Block->Clone(_Heap.Block, resource());
+      else if (_Size <= inline_capacity) {
+        // - Short interned payload goes back to inline storage
+        Block = _Heap.Block;
+        std::memcpy(_Inline, block::payload(Block), _Size);
+        unref(Block);
+        _Capacity = inline_capacity;
+        return;
+      } else {
+        Block = allocate(resource(), _Size);
+        std::memcpy(block::payload(Block), _Heap.Data, _Size);
+        _Capacity = _Size;
+      }
+      Block->Hash.store(_Heap.Block->Hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      unref(_Heap.Block);
+      _Heap.Block = Block;
+      _Heap.Data  = block::payload(Block);
+    }
+
+    //! Free heap storage
+    void release() noexcept {
+      if (!is_inline()) unref(_Heap.Block);
+      _Capacity = inline_capacity;
+    }
+
+  private:
+    //! Heap block reference
+    struct heap {
+      block         * Block;
+      std::uint8_t  * Data;
+    };
+
+    //! Inline storage or heap block
+    union {
+      std::uint8_t      _Inline[inline_capacity];
+      heap              _Heap;
+    };
+
+    //! Size of stored data
+    std::size_t                 _Size;
+
+    //! Capacity of current storage
+    std::size_t                 _Capacity;
+
+    //! Memory resource for heap storage, default resource if null
+    std::pmr::memory_resource * _Resource;
+
+    //! Capacity retention policy
+    CapacityPolicy              _Policy;
+
+    //! Heap capacity limit for CapacityPolicy::HighWaterMark
+    static inline std::atomic<std::size_t> _HighWaterMark {4096};
+  };
+
+  /**
+   * @brief Memory resource adapter for custom allocators
+   *
+   * Allows to build dynamic on top of any standard conforming allocator.
+   */
+  template <typename Allocator>
+  class allocator_resource : public std::pmr::memory_resource {
+  public:
+    explicit allocator_resource(const Allocator & Alloc = Allocator()) : _Allocator(Alloc) {}
+
+  private:
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<std::max_align_t> Aligned;
+
+    void * do_allocate(std::size_t Bytes, std::size_t Alignment) override {
+      if (Alignment > alignof(std::max_align_t)) throw std::bad_alloc();
+      return std::allocator_traits<Aligned>::allocate(_Allocator, units(Bytes));
+    }
+
+    void do_deallocate(void * Pointer, std::size_t Bytes, std::size_t) override {
+      std::allocator_traits<Aligned>::deallocate(_Allocator, static_cast<std::max_align_t*>(Pointer), units(Bytes));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource & Other) const noexcept override {
+      const allocator_resource * Same = dynamic_cast<const allocator_resource*>(&Other);
+      return Same && Same->_Allocator == _Allocator;
+    }
+
+    //! Get number of aligned units required for given number of bytes
+    static std::size_t units(std::size_t Bytes) {
+      return (Bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    }
+
+    //! Underlying allocator
+    Aligned _Allocator;
+  };
+
+  //! Non-owning view on raw data
+  class span {
+  public:
+    typedef std::uint8_t        value_type;
+    typedef const std::uint8_t* iterator;
+    typedef const std::uint8_t* const_iterator;
+
+    span() : _Data(nullptr), _Size(0) {}
+    span(const std::uint8_t * Data, std::size_t Size) : _Data(Data), _Size(Size) {}
+
+    const std::uint8_t * data() const {return _Data;}
+    std::size_t size() const          {return _Size;}
+    bool empty() const                {return !_Size;}
+    iterator begin() const            {return _Data;}
+    iterator end() const              {return _Data + _Size;}
+
+    const std::uint8_t & operator [] (std::size_t Index) const {return _Data[Index];}
+
+  private:
+    const std::uint8_t  * _Data;
+    std::size_t           _Size;
+  };
+
+  //! Object member, String key and value
+  typedef std::pair<dynamic, dynamic> member;
+
+  //! Array storage, elements are kept contiguously
+  typedef std::pmr::vector<dynamic>   array_type;
+
+  //! Object storage, members are kept sorted by key
+  typedef std::pmr::vector<member>    object_type;
+
 public:
 
   dynamic() {__init__();}
 
+  //! Create undefined value with heap storage allocated from given memory resource
+  explicit dynamic(std::pmr::memory_resource * Resource) : _Value(Resource) {__init__();}
+
+  //! Create value with heap storage allocated from given memory resource
+  template <typename T>
+  dynamic(T && Value, std::pmr::memory_resource * Resource) : _Value(Resource) {__init__(); *this = std::forward<T>(Value);}
+
   dynamic(std::int8_t Value)    {__init__(); *this = Value;}
   dynamic(std::int16_t Value)   {__init__(); *this = Value;}
   dynamic(std::int32_t Value)   {__init__(); *this = Value;}
@@ -65,10 +1061,17 @@ public:
   dynamic(double Value) {__init__(); *this = Value;}
 
   dynamic(const char * Value)                       {__init__(); *this = Value;}
-  dynamic(const char * Value, std::size_t Size)     {__init__(); *this = std::string(Value, Size);}
+  dynamic(const char * Value, std::size_t Size)     {__init__(); if (Size) {value_rw().assign(Value, Value + Size); setType(Type::String);}}
   dynamic(const std::string & Value)                {__init__(); *this = Value;}
+  dynamic(std::string && Value)                     {__init__(); *this = std::move(Value);}
   dynamic(const std::vector<std::uint8_t> & Value)  {__init__(); *this = Value;}
+  dynamic(std::vector<std::uint8_t> && Value)       {__init__(); *this = std::move(Value);}
+  dynamic(const array_type & Value)                 {__init__(); *this = Value;}
+  dynamic(array_type && Value)                      {__init__(); *this = std::move(Value);}
+  dynamic(const object_type & Value)                {__init__(); *this = Value;}
+  dynamic(object_type && Value)                     {__init__(); *this = std::move(Value);}
   dynamic(const dynamic & Value)                    {__init__(); *this = Value;}
+  dynamic(dynamic && Value) noexcept                : _Value(std::move(Value._Value)), _StoredType(Value._StoredType) {Value.setType(Type::Undefined);}
 
 #ifdef __DYNAMIC__WITH_UUIDPP__
   dynamic(const UUID& Value)                        {__init__(); *this = Value;}
@@ -101,22 +1104,69 @@ public:
     std::copy(Value.begin(), Value.end(), value_rw().begin());
     setType(Type::String);
   }
+  void operator = (std::string && Value) {
+    if (Value.empty()) return;
+    value_rw().adopt(std::move(Value));
+    setType(Type::String);
+  }
   void operator = (const std::vector<std::uint8_t> & Value) {
     if (Value.empty()) return;
     resize(Value.size());
     copy(Value.begin(), Value.end(), value_rw().begin());
     setType(Type::Binary);
   }
+  void operator = (std::vector<std::uint8_t> && Value) {
+    if (Value.empty()) return;
+    value_rw().adopt(std::move(Value));
+    setType(Type::Binary);
+  }
+  void operator = (const array_type & Value) {
+    *this = array_type(Value, resource());
+  }
+  void operator = (array_type && Value) {
+    value_rw().store(std::move(Value));
+    setType(Type::Array);
+  }
+  void operator = (const object_type & Value) {
+    *this = object_type(Value, resource());
+  }
+  void operator = (object_type && Value) {
+    sortMembers(Value);
+    value_rw().store(std::move(Value));
+    setType(Type::Object);
+  }
   void operator = (const dynamic & Value) {
-    resize(Value.size());
-    std::copy(Value.value().begin(), Value.value().end(), value_rw().begin());
+    if (this == &Value) return;
+    statistics::copied();
+    // - Value may be element of current Array or Object, keep the container alive until it is copied
+    if (value().is_container()) {
+      dynamic Previous(std::move(*this));
+      value_rw()  = Value.value();
+      _StoredType = Value._StoredType;
+      return;
+    }
+    value_rw()  = Value.value();
+    _StoredType = Value._StoredType;
+  }
+  void operator = (dynamic && Value) {
+    if (this == &Value) return;
+    statistics::moved();
+    if (value().is_container()) {
+      dynamic Previous(std::move(*this));
+      value_rw()  = std::move(Value.value_rw());
+      _StoredType = Value._StoredType;
+      Value.setType(Type::Undefined);
+      return;
+    }
+    value_rw()  = std::move(Value.value_rw());
     _StoredType = Value._StoredType;
+    Value.setType(Type::Undefined);
   }
 
 #ifdef __DYNAMIC__WITH_UUIDPP__
   void operator = (const UUID & Value) {
     resize(UUID::binary_size());
-    Value.copyTo(&value_rw()[0]);
+    Value.copyTo(value_rw().data());
     setType(Type::UUID);
   }
 #endif
@@ -133,15 +1183,14 @@ public:
   operator std::uint64_t() const  {return asNumeric<std::uint64_t>();}
 
   operator bool() const {
+    statistics::conversion Probe(type(), statistics::Target::Bool);
     switch (type()) {
-      case Type::UnsignedInt: case Type::SignedInt: case Type::Float: return asNumeric<bool>();
-      case Type::String: {
-        std::string Value = *this;
-        std::transform(Value.begin(), Value.end(), Value.begin(), ::tolower);
-        if (      Value == "true"   || Value == "yes" || Value == "1" || Value == "on"   || Value == "enabled"  ) return true;
-        else if ( Value == "false"  || Value == "no"  || Value == "0" || Value == "off"  || Value == "disabled" ) return false;
-        else throw std::bad_cast();
-      }; break;
+      case Type::UnsignedInt: case Type::SignedInt: case Type::Float: {
+        bool Result;
+        if (!tryNumeric(Result)) throw std::bad_cast();
+        return Result;
+      }
+      case Type::String: return parseBool(as_string_view());
       #ifdef __DYNAMIC__WITH_UUIDPP__
       case Type::UUID: return UUID(value().data());
       #endif
@@ -151,37 +1200,17 @@ public:
   operator float() const  {return asNumeric<float>();}
   operator double() const {return asNumeric<double>();}
   operator std::string() const {
+    statistics::conversion Probe(type(), statistics::Target::String);
     switch (type()) {
       case Type::Undefined:           return std::string();
       case Type::SignedInt:
-        switch (size()) {
-          case sizeof(std::int8_t):   return std::to_string(cast<std::int8_t>());
-          case sizeof(std::int16_t):  return std::to_string(cast<std::int16_t>());
-          case sizeof(std::int32_t):  return std::to_string(cast<std::int32_t>());
-          case sizeof(std::int64_t):  return std::to_string(cast<std::int64_t>());
-          default: throw std::bad_cast();
-        }
       case Type::UnsignedInt:
-        switch (size()) {
-          case sizeof(std::uint8_t):   return std::to_string(cast<std::uint8_t>());
-          case sizeof(std::uint16_t):  return std::to_string(cast<std::uint16_t>());
-          case sizeof(std::uint32_t):  return std::to_string(cast<std::uint32_t>());
-          case sizeof(std::uint64_t):  return std::to_string(cast<std::uint64_t>());
-          default: throw std::bad_cast();
-        }
-      case Type::Float:
-        switch (size()) {
-          case sizeof(float):   return std::to_string(cast<float>());
-          case sizeof(double):  return std::to_string(cast<double>());
-          default: throw std::bad_cast();
-        }
-      case Type::String:
-      case Type::Binary: {
-        std::string Result;
-        Result.resize(size());
-        std::copy(value().begin(), value().end(), Result.begin());
-        return Result;
+      case Type::Float: {
+        char Buffer[max_numeric_length];
+        return std::string(Buffer, formatText(Buffer, sizeof(Buffer)));
       }
+      case Type::String:
+      case Type::Binary:              return std::string(reinterpret_cast<const char*>(data()), size());
       #ifdef __DYNAMIC__WITH_UUIDPP__
       case Type::UUID: {
         return UUID::toString(value().data());
@@ -191,7 +1220,9 @@ public:
     }
   }
   operator std::vector<std::uint8_t>() const {
-    return value();
+    statistics::conversion Probe(type(), statistics::Target::Binary);
+    if (value().is_container()) throw std::bad_cast();
+    return std::vector<std::uint8_t>(value().begin(), value().end());
   }
 
   #ifdef __DYNAMIC__WITH_UUIDPP__
@@ -213,154 +1244,296 @@ public:
     return static_cast<T>(*this);
   }
 
-public:
-  bool operator == (std::int8_t Second) const   {return Second == cast<std::int8_t>();}
-  bool operator == (std::int16_t Second) const  {return Second == cast<std::int16_t>();}
-  bool operator == (std::int32_t Second) const  {return Second == cast<std::int32_t>();}
-  bool operator == (std::int64_t Second) const  {return Second == cast<std::int64_t>();}
+  //! Cast to specified type without throwing std::bad_cast, empty result when value can not be converted
+  template <typename T>
+  std::optional<T> try_cast() const {
+    if constexpr (std::is_same<T, bool>::value) {
+      statistics::conversion Probe(type(), statistics::Target::Bool);
+      bool Result;
+      switch (type()) {
+        case Type::UnsignedInt: case Type::SignedInt: case Type::Float: if (tryNumeric(Result)) return Result; break;
+        case Type::String: if (parseBool(as_string_view(), Result)) return Result; break;
+        #ifdef __DYNAMIC__WITH_UUIDPP__
+        case Type::UUID: return cast<bool>();
+        #endif
+        default: break;
+      }
+      Probe.fail();
+      return std::nullopt;
+    } else if constexpr (std::is_arithmetic<T>::value) {
+      statistics::conversion Probe(type(), statistics::target<T>());
+      T Result;
+      if (tryNumeric(Result)) return Result;
+      Probe.fail();
+      return std::nullopt;
+    } else if constexpr (std::is_same<T, std::string>::value) {
+      switch (kind()) {
+        case Kind::Array: case Kind::Object: case Kind::Invalid: return std::nullopt;
+        default: return cast<std::string>();
+      }
+    } else {
+      // - Remaining conversions have no separate non-throwing path
+      try {
+        return cast<T>();
+      } catch (const std::bad_cast &) {
+        return std::nullopt;
+      }
+    }
+  }
 
-  bool operator == (std::uint8_t Second) const  {return Second == cast<std::uint8_t>();}
-  bool operator == (std::uint16_t Second) const {return Second == cast<std::uint16_t>();}
-  bool operator == (std::uint32_t Second) const {return Second == cast<std::uint32_t>();}
-  bool operator == (std::uint64_t Second) const {return Second == cast<std::uint64_t>();}
+  //! Get stored numeric value, Array elements or Object members when stored type and width are exactly the requested ones, nullptr otherwise
+  template <typename T>
+  const T * get_if() const noexcept {
+    if constexpr (std::is_same<T, array_type>::value) {
+      return type() == Type::Array ? &elements() : nullptr;
+    } else if constexpr (std::is_same<T, object_type>::value) {
+      return type() == Type::Object ? &members() : nullptr;
+    } else {
+      static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Unsupported type");
+      constexpr Type Stored = std::is_floating_point<T>::value ? Type::Float : std::is_signed<T>::value ? Type::SignedInt : Type::UnsignedInt;
+      return type() == Stored && size() == sizeof(T) ? reinterpret_cast<const T*>(data()) : nullptr;
+    }
+  }
 
-  bool operator == (bool Second) const          {return Second == cast<bool>();}
-  bool operator == (float Second) const         {return Second == cast<float>();}
-  bool operator == (double Second) const        {return Second == cast<double>();}
-  bool operator == (const char * Second) const  {return cast<std::string>() == Second;}
-  bool operator == (const std::string & Second) const {return Second == cast<std::string>();}
+  //! Get modifiable stored numeric value or Array elements, Object members are read only to keep them sorted
+  template <typename T, typename = typename std::enable_if<!std::is_same<T, object_type>::value>::type>
+  T * get_if() {
+    if constexpr (std::is_same<T, array_type>::value) {
+      return type() == Type::Array ? &elements() : nullptr;
+    } else {
+      return static_cast<const dynamic&>(*this).get_if<T>() ? reinterpret_cast<T*>(data()) : nullptr;
+    }
+  }
 
-  bool operator == (const dynamic & Second) const {
-    Type    T = getMajorType(*this, Second);
-    size_t  S = std::max(size(), Second.size());
-    switch (T) {
+  /**
+   * Call function with stored value as native type selected by single switch on kind(): nullptr for
+   * Undefined, integer or floating point type of stored width, std::string_view for String, span
+   * for Binary, array_type or object_type. Function must return the same type for all of them.
+   */
+  template <typename F>
+  decltype(auto) visit(F && Function) const {
+    switch (kind()) {
+      case Kind::Undefined: return Function(nullptr);
+      case Kind::Int8:      return Function(*reinterpret_cast<const std::int8_t*>(data()));
+      case Kind::Int16:     return Function(*reinterpret_cast<const std::int16_t*>(data()));
+      case Kind::Int32:     return Function(*reinterpret_cast<const std::int32_t*>(data()));
+      case Kind::Int64:     return Function(*reinterpret_cast<const std::int64_t*>(data()));
+      case Kind::UInt8:     return Function(*reinterpret_cast<const std::uint8_t*>(data()));
+      case Kind::UInt16:    return Function(*reinterpret_cast<const std::uint16_t*>(data()));
+      case Kind::UInt32:    return Function(*reinterpret_cast<const std::uint32_t*>(data()));
+      case Kind::UInt64:    return Function(*reinterpret_cast<const std::uint64_t*>(data()));
+      case Kind::Float32:   return Function(*reinterpret_cast<const float*>(data()));
+      case Kind::Float64:   return Function(*reinterpret_cast<const double*>(data()));
+      case Kind::String:    return Function(std::string_view(reinterpret_cast<const char*>(data()), size()));
+      case Kind::Binary:    return Function(as_span());
+      case Kind::Array:     return Function(elements());
+      case Kind::Object:    return Function(members());
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Convert number widened to int64, uint64 or double to numeric type, returns false when integer type can not represent it (NaN included)
+  template <typename V, typename T>
+  static bool narrow(V Value, T & Result) noexcept {
+    if constexpr (std::is_floating_point<T>::value || std::is_same<T, bool>::value) {
+      Result = static_cast<T>(Value);
+      return true;
+    } else if constexpr (std::is_floating_point<V>::value) {
+      // - Bounds are powers of two, exact in double; NaN fails both comparisons
+      V Integral = std::trunc(Value);
+      if (!(Integral >= static_cast<V>(std::numeric_limits<T>::min()) && Integral < static_cast<V>(std::numeric_limits<T>::max() / 2 + 1) * 2)) return false;
+      Result = static_cast<T>(Integral);
+      return true;
+    } else if constexpr (std::is_signed<V>::value) {
+      if (Value < 0) {
+        if constexpr (std::is_unsigned<T>::value) return false;
+        else if (Value < static_cast<V>(std::numeric_limits<T>::min())) return false;
+      } else if (static_cast<std::uint64_t>(Value) > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) return false;
+      Result = static_cast<T>(Value);
+      return true;
+    } else {
+      if (Value > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) return false;
+      Result = static_cast<T>(Value);
+      return true;
+    }
+  }
+
+  //! Maximum length of text representation of numeric value
+  static constexpr std::size_t max_numeric_length = 32;
+
+  //! Write text representation to given buffer without heap allocation, returns number of written characters
+  std::size_t format_to(char * Buffer, std::size_t BufferSize) const {
+    statistics::conversion Probe(type(), statistics::Target::Text);
+    return formatText(Buffer, BufferSize);
+  }
+
+private:
+  //! Write text representation to given buffer
+  std::size_t formatText(char * Buffer, std::size_t BufferSize) const {
+    switch (type()) {
+      case Type::Undefined: return 0;
       case Type::SignedInt:
-        switch (S) {
-          case sizeof(std::int8_t):   return (cast<std::int8_t>() == Second.cast<std::int8_t>());
-          case sizeof(std::int16_t):  return (cast<std::int16_t>() == Second.cast<std::int16_t>());
-          case sizeof(std::int32_t):  return (cast<std::int32_t>() == Second.cast<std::int32_t>());
-          case sizeof(std::int64_t):  return (cast<std::int64_t>() == Second.cast<std::int64_t>());
+        switch (size()) {
+          case sizeof(std::int8_t):   return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::int8_t*>(data()));
+          case sizeof(std::int16_t):  return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::int16_t*>(data()));
+          case sizeof(std::int32_t):  return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::int32_t*>(data()));
+          case sizeof(std::int64_t):  return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::int64_t*>(data()));
           default: throw std::bad_cast();
         }
       case Type::UnsignedInt:
-        switch (S) {
-          case sizeof(std::uint8_t):   return (cast<std::uint8_t>() == Second.cast<std::uint8_t>());
-          case sizeof(std::uint16_t):  return (cast<std::uint16_t>() == Second.cast<std::uint16_t>());
-          case sizeof(std::uint32_t):  return (cast<std::uint32_t>() == Second.cast<std::uint32_t>());
-          case sizeof(std::uint64_t):  return (cast<std::uint64_t>() == Second.cast<std::uint64_t>());
+        switch (size()) {
+          case sizeof(std::uint8_t):  return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::uint8_t*>(data()));
+          case sizeof(std::uint16_t): return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::uint16_t*>(data()));
+          case sizeof(std::uint32_t): return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::uint32_t*>(data()));
+          case sizeof(std::uint64_t): return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const std::uint64_t*>(data()));
           default: throw std::bad_cast();
         }
       case Type::Float:
-        switch (S) {
-          case sizeof(float):   return (cast<float>() == Second.cast<float>());
-          case sizeof(double):  return (cast<double>() == Second.cast<double>());
+        switch (size()) {
+          case sizeof(float):   return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const float*>(data()));
+          case sizeof(double):  return formatNumeric(Buffer, BufferSize, *reinterpret_cast<const double*>(data()));
           default: throw std::bad_cast();
         }
-      case Type::String: return (cast<std::string>() == Second.cast<std::string>());
+      case Type::String:
       case Type::Binary:
-        if (size() != Second.size()) return false;
-        return !std::memcmp(data(), Second.data(), S);
-      default:
-        throw std::bad_cast();
+        copyTo(reinterpret_cast<std::uint8_t*>(Buffer), BufferSize);
+        return size();
+      #ifdef __DYNAMIC__WITH_UUIDPP__
+      case Type::UUID: {
+        std::string Text = UUID::toString(value().data());
+        if (BufferSize < Text.size()) throw std::overflow_error("Buffer to small");
+        std::copy(Text.begin(), Text.end(), Buffer);
+        return Text.size();
+      };
+      #endif
+      default: throw std::bad_cast();
     }
   }
 
+public:
+  bool operator == (std::int8_t Second) const   {return *this == dynamic(Second);}
+  bool operator == (std::int16_t Second) const  {return *this == dynamic(Second);}
+  bool operator == (std::int32_t Second) const  {return *this == dynamic(Second);}
+  bool operator == (std::int64_t Second) const  {return *this == dynamic(Second);}
+
+  bool operator == (std::uint8_t Second) const  {return *this == dynamic(Second);}
+  bool operator == (std::uint16_t Second) const {return *this == dynamic(Second);}
+  bool operator == (std::uint32_t Second) const {return *this == dynamic(Second);}
+  bool operator == (std::uint64_t Second) const {return *this == dynamic(Second);}
+
+  bool operator == (bool Second) const          {return Second == cast<bool>();}
+  bool operator == (float Second) const         {return *this == dynamic(Second);}
+  bool operator == (double Second) const        {return *this == dynamic(Second);}
+  bool operator == (const char * Second) const  {return !compareText(Second);}
+  bool operator == (const std::string & Second) const {return !compareText(Second);}
+  bool operator == (std::string_view Second) const    {return !compareText(Second);}
+
+  bool operator == (const dynamic & Second) const {
+    // - Interned Strings are equal only when they share block
+    if (isInterned() && Second.isInterned()) return value().same_block(Second.value());
+    return !promotion::compare(*this, Second);
+  }
 
 public:
-  bool operator != (std::int8_t Second) const     {return Second != cast<std::int8_t>();}
-  bool operator != (std::int16_t Second) const    {return Second != cast<std::int8_t>();}
-  bool operator != (std::int32_t Second) const    {return Second != cast<std::int8_t>();}
-  bool operator != (std::int64_t Second) const    {return Second != cast<std::int8_t>();}
+  bool operator != (std::int8_t Second) const     {return *this != dynamic(Second);}
+  bool operator != (std::int16_t Second) const    {return *this != dynamic(Second);}
+  bool operator != (std::int32_t Second) const    {return *this != dynamic(Second);}
+  bool operator != (std::int64_t Second) const    {return *this != dynamic(Second);}
 
-  bool operator != (std::uint8_t Second) const    {return Second != cast<std::uint8_t>();}
-  bool operator != (std::uint16_t Second) const   {return Second != cast<std::uint16_t>();}
-  bool operator != (std::uint32_t Second) const   {return Second != cast<std::uint32_t>();}
-  bool operator != (std::uint64_t Second) const   {return Second != cast<std::uint64_t>();}
+  bool operator != (std::uint8_t Second) const    {return *this != dynamic(Second);}
+  bool operator != (std::uint16_t Second) const   {return *this != dynamic(Second);}
+  bool operator != (std::uint32_t Second) const   {return *this != dynamic(Second);}
+  bool operator != (std::uint64_t Second) const   {return *this != dynamic(Second);}
 
   bool operator != (bool Second) const    {return Second != cast<bool>();}
-  bool operator != (float Second) const   {return Second != cast<float>();}
-  bool operator != (double Second) const  {return Second != cast<double>();}
+  bool operator != (float Second) const   {return *this != dynamic(Second);}
+  bool operator != (double Second) const  {return *this != dynamic(Second);}
 
-  bool operator != (const std::string & Second) const {return Second != cast<std::string>();}
-  bool operator != (const char * Second) const        {return cast<std::string>() != Second;}
+  bool operator != (const std::string & Second) const {return compareText(Second) != 0;}
+  bool operator != (const char * Second) const        {return compareText(Second) != 0;}
+  bool operator != (std::string_view Second) const    {return compareText(Second) != 0;}
+
+  bool operator != (const dynamic & Second) const {return !(*this == Second);}
 
 public:
-  bool operator < (std::int8_t Second) const          {return cast<std::int8_t>() < Second;}
-  bool operator < (std::int16_t Second) const         {return cast<std::int16_t>() < Second;}
-  bool operator < (std::int32_t Second) const         {return cast<std::int32_t>() < Second;}
-  bool operator < (std::int64_t Second) const         {return cast<std::int64_t>() < Second;}
-  bool operator < (std::uint8_t Second) const         {return cast<std::uint8_t>() < Second;}
-  bool operator < (std::uint16_t Second) const        {return cast<std::uint16_t>() < Second;}
-  bool operator < (std::uint32_t Second) const        {return cast<std::uint32_t>() < Second;}
-  bool operator < (std::uint64_t Second) const        {return cast<std::uint64_t>() < Second;}
-  bool operator < (const std::string & Second) const  {return cast<std::string>() < Second;}
-  bool operator < (const char * Second) const         {return cast<std::string>() < Second;}
-
-  bool operator < (const dynamic& Second) const { return false; }
+  bool operator < (std::int8_t Second) const          {return *this < dynamic(Second);}
+  bool operator < (std::int16_t Second) const         {return *this < dynamic(Second);}
+  bool operator < (std::int32_t Second) const         {return *this < dynamic(Second);}
+  bool operator < (std::int64_t Second) const         {return *this < dynamic(Second);}
+  bool operator < (std::uint8_t Second) const         {return *this < dynamic(Second);}
+  bool operator < (std::uint16_t Second) const        {return *this < dynamic(Second);}
+  bool operator < (std::uint32_t Second) const        {return *this < dynamic(Second);}
+  bool operator < (std::uint64_t Second) const        {return *this < dynamic(Second);}
+  bool operator < (float Second) const                {return *this < dynamic(Second);}
+  bool operator < (double Second) const               {return *this < dynamic(Second);}
+  bool operator < (const std::string & Second) const  {return compareText(Second) < 0;}
+  bool operator < (const char * Second) const         {return compareText(Second) < 0;}
+  bool operator < (std::string_view Second) const     {return compareText(Second) < 0;}
+
+  bool operator < (const dynamic & Second) const  {return promotion::compare(*this, Second) == promotion::less;}
+  bool operator <= (const dynamic & Second) const {int R = promotion::compare(*this, Second); return R == promotion::less || R == promotion::equal;}
+  bool operator > (const dynamic & Second) const  {return promotion::compare(*this, Second) == promotion::greater;}
+  bool operator >= (const dynamic & Second) const {int R = promotion::compare(*this, Second); return R == promotion::greater || R == promotion::equal;}
 
-public:
-  bool operator > (const dynamic& Second) const { return false; }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool operator <= (T Second) const {return *this <= dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool operator > (T Second) const  {return *this > dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool operator >= (T Second) const {return *this >= dynamic(Second);}
 
 public:
-  dynamic operator + (std::int8_t Second) const {
-    switch (_StoredType) {
-      case Type::SignedInt:
-        switch (size()) {
-          case sizeof(std::int8_t):   return (cast<std::int8_t>() + Second);
-          case sizeof(std::int16_t):  return (cast<std::int16_t>() + Second);
-          case sizeof(std::int32_t):  return (cast<std::int32_t>() + Second);
-          case sizeof(std::int64_t):  return (cast<std::int64_t>() + Second);
-          default: throw std::bad_cast();
-        }
-
-      // - Not implemented yet
-      default: throw std::bad_exception();
-    }
-  }
+  dynamic operator + (const dynamic & Second) const {return promotion::apply<Operation::Add>(*this, Second);}
+  dynamic operator - (const dynamic & Second) const {return promotion::apply<Operation::Subtract>(*this, Second);}
+  dynamic operator * (const dynamic & Second) const {return promotion::apply<Operation::Multiply>(*this, Second);}
+  dynamic operator / (const dynamic & Second) const {return promotion::apply<Operation::Divide>(*this, Second);}
+  dynamic operator % (const dynamic & Second) const {return promotion::apply<Operation::Modulo>(*this, Second);}
 
-  void operator += (std::int8_t Second) {
-    switch (type()) {
-      case Type::Undefined: *this = Second; return;
-      case Type::SignedInt:
-        switch (size()) {
-          case sizeof(std::int8_t):   *this = (cast<std::int8_t>() + Second);   return;
-          case sizeof(std::int16_t):  *this = (cast<std::int16_t>() + Second);  return;
-          case sizeof(std::int32_t):  *this = (cast<std::int32_t>() + Second);  return;
-          case sizeof(std::int64_t):  *this = (cast<std::int64_t>() + Second);  return;
-          default: throw std::bad_cast();
-        }
-      case Type::UnsignedInt:
-        switch (size()) {
-          case sizeof(std::uint8_t):  *this = (cast<std::uint8_t>() + Second);  return;
-          case sizeof(std::uint16_t): *this = (cast<std::uint16_t>() + Second); return;
-          case sizeof(std::uint32_t): *this = (cast<std::uint32_t>() + Second); return;
-          case sizeof(std::uint64_t): *this = (cast<std::uint64_t>() + Second); return;
-          default: throw std::bad_cast();
-        }
-      case Type::Float:
-        switch (size()) {
-          case sizeof(float):   *this = (cast<float>() + Second);   return;
-          case sizeof(double):  *this = (cast<double>() + Second);  return;
-          default: throw std::bad_cast();
-        }
-      case Type::String: {
+  dynamic operator + (const char * Second) const    {return *this + dynamic(Second);}
 
-      }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  dynamic operator + (T Second) const {return *this + dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  dynamic operator - (T Second) const {return *this - dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  dynamic operator * (T Second) const {return *this * dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  dynamic operator / (T Second) const {return *this / dynamic(Second);}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  dynamic operator % (T Second) const {return *this % dynamic(Second);}
 
-      case Type::Binary: {
+  void operator += (const dynamic & Second) {*this = *this + Second;}
+  void operator -= (const dynamic & Second) {*this = *this - Second;}
+  void operator *= (const dynamic & Second) {*this = *this * Second;}
+  void operator /= (const dynamic & Second) {*this = *this / Second;}
+  void operator %= (const dynamic & Second) {*this = *this % Second;}
 
-      }
-      #ifdef __DYNAMIC__WITH_UUIDPP__
-      case Type::UUID: {
+public:
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator == (T First, const dynamic & Second) {return dynamic(First) == Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator != (T First, const dynamic & Second) {return dynamic(First) != Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator < (T First, const dynamic & Second)  {return dynamic(First) < Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator <= (T First, const dynamic & Second) {return dynamic(First) <= Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator > (T First, const dynamic & Second)  {return dynamic(First) > Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend bool operator >= (T First, const dynamic & Second) {return dynamic(First) >= Second;}
 
-      }
-      #endif
-    }
-  }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend dynamic operator + (T First, const dynamic & Second) {return dynamic(First) + Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend dynamic operator - (T First, const dynamic & Second) {return dynamic(First) - Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend dynamic operator * (T First, const dynamic & Second) {return dynamic(First) * Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend dynamic operator / (T First, const dynamic & Second) {return dynamic(First) / Second;}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  friend dynamic operator % (T First, const dynamic & Second) {return dynamic(First) % Second;}
 
-  dynamic operator + (std::int16_t Second) const {
-    return dynamic();
-  }
+  friend dynamic operator + (const char * First, const dynamic & Second) {return dynamic(First) + Second;}
 
 public:
   //! Get size of raw data
@@ -375,16 +1548,46 @@ public:
 
   //! Access raw data buffer
   std::uint8_t * data() {
-    return &value_rw()[0];
+    return value_rw().data();
+  }
+
+  //! Access raw data without copying
+  span as_span() const {
+    return span(data(), size());
+  }
+
+  //! Access String or Binary payload as text without copying
+  std::string_view as_string_view() const {
+    switch (type()) {
+      case Type::Undefined: return std::string_view();
+      case Type::String:
+      case Type::Binary:    return std::string_view(reinterpret_cast<const char*>(data()), size());
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Create String sharing one immutable payload with all equal interned Strings, hash is computed once
+  static dynamic intern(std::string_view Text) {
+    if (Text.empty()) return dynamic(Text.data(), Text.size());
+    dynamic Result;
+    Result.value_rw().intern(reinterpret_cast<const std::uint8_t*>(Text.data()), Text.size(),
+                             hashBytes(reinterpret_cast<const std::uint8_t*>(Text.data()), Text.size(), string_rank));
+    Result.setType(Type::String);
+    return Result;
+  }
+
+  //! Check is value interned String, interned Strings compare by identity
+  bool isInterned() const {
+    return type() == Type::String && value().is_interned();
   }
 
   //! Access raw data
-  const std::vector<std::uint8_t> & value() const {
+  const buffer & value() const {
     return _Value;
   }
 
   //! Access raw data
-  std::vector<std::uint8_t> & value() {
+  buffer & value() {
     return _Value;
   }
 
@@ -412,15 +1615,274 @@ public:
     return _StoredType;
   }
 
+  //! Get kind of stored value
+  Kind kind() const {
+    static constexpr Kind Signed[]    = {Kind::Invalid, Kind::Int8, Kind::Int16, Kind::Invalid, Kind::Int32, Kind::Invalid, Kind::Invalid, Kind::Invalid, Kind::Int64};
+    static constexpr Kind Unsigned[]  = {Kind::Invalid, Kind::UInt8, Kind::UInt16, Kind::Invalid, Kind::UInt32, Kind::Invalid, Kind::Invalid, Kind::Invalid, Kind::UInt64};
+    static constexpr Kind Floating[]  = {Kind::Invalid, Kind::Invalid, Kind::Invalid, Kind::Invalid, Kind::Float32, Kind::Invalid, Kind::Invalid, Kind::Invalid, Kind::Float64};
+    switch (type()) {
+      case Type::Undefined:   return Kind::Undefined;
+      case Type::SignedInt:   return size() < sizeof(Signed) ? Signed[size()] : Kind::Invalid;
+      case Type::UnsignedInt: return size() < sizeof(Unsigned) ? Unsigned[size()] : Kind::Invalid;
+      case Type::Float:       return size() < sizeof(Floating) ? Floating[size()] : Kind::Invalid;
+      case Type::String:      return Kind::String;
+      case Type::Array:       return Kind::Array;
+      case Type::Object:      return Kind::Object;
+      default:                return Kind::Binary;
+    }
+  }
+
+  //! Hash of value, consistent with totalOrder(): equal numbers hash the same regardless of type and width
+  std::size_t hash() const {
+    switch (kind()) {
+      case Kind::Undefined: return 0;
+      case Kind::String:
+      case Kind::Binary:
+      case Kind::Invalid: {
+        // - Hash of large heap stored payload is cached in heap block
+        std::uint64_t Result = value().cached_hash();
+        if (Result) return static_cast<std::size_t>(Result);
+        Result = hashBytes(data(), size(), static_cast<std::uint64_t>(rank()));
+        if (size() >= cached_hash_size) value().cache_hash(Result);
+        return static_cast<std::size_t>(Result);
+      }
+      case Kind::Array: {
+        std::uint64_t Result = mix(static_cast<std::uint64_t>(rank()));
+        for (const dynamic & Element : elements()) Result = mix(Result * 0x9E3779B97F4A7C15ull + Element.hash());
+        return static_cast<std::size_t>(Result);
+      }
+      case Kind::Object: {
+        std::uint64_t Result = mix(static_cast<std::uint64_t>(rank()));
+        for (const member & Member : members()) {
+          Result = mix(Result * 0x9E3779B97F4A7C15ull + Member.first.hash());
+          Result = mix(Result * 0x9E3779B97F4A7C15ull + Member.second.hash());
+        }
+        return static_cast<std::size_t>(Result);
+      }
+      default: {
+        number Value = toNumber();
+        if (Value.Class == number::Floating) {
+          if (std::isnan(Value.Float)) return static_cast<std::size_t>(mix(0x7FF8000000000000ull));
+          // - Integral floats hash as integers
+          if (std::trunc(Value.Float) == Value.Float && Value.Float >= -9223372036854775808.0 && Value.Float < 18446744073709551616.0) {
+            if (Value.Float < 0) return static_cast<std::size_t>(mix(static_cast<std::uint64_t>(static_cast<std::int64_t>(Value.Float))));
+            return static_cast<std::size_t>(mix(static_cast<std::uint64_t>(Value.Float)));
+          }
+          std::uint64_t Bits;
+          std::memcpy(&Bits, &Value.Float, sizeof(Bits));
+          return static_cast<std::size_t>(mix(Bits));
+        }
+        return static_cast<std::size_t>(mix(Value.Class == number::Integer ? static_cast<std::uint64_t>(Value.Signed) : Value.Unsigned));
+      }
+    }
+  }
+
+  /**
+   * Total order over all values, returns negative, zero or positive value.
+   * Undefined goes first, then numbers, String, Binary, Array and Object values. Numbers are ordered
+   * by value regardless of type and width, NaN follows all numbers. String and Binary are ordered
+   * bytewise, Array elements and Object members (by key, then value) lexicographically.
+   */
+  static int totalOrder(const dynamic & First, const dynamic & Second) {
+    int FirstRank = First.rank(), SecondRank = Second.rank();
+    if (FirstRank != SecondRank) return FirstRank < SecondRank ? -1 : 1;
+    switch (FirstRank) {
+      case 0: return 0;
+      case 1: return compareNumbers(First.toNumber(), Second.toNumber());
+      case 4: {
+        const array_type & A = First.elements(), & B = Second.elements();
+        if (&A == &B) return 0;
+        for (std::size_t Index = 0; Index < A.size() && Index < B.size(); ++Index) {
+          if (int Result = totalOrder(A[Index], B[Index])) return Result;
+        }
+        return A.size() < B.size() ? -1 : A.size() > B.size() ? 1 : 0;
+      }
+      case 5: {
+        const object_type & A = First.members(), & B = Second.members();
+        if (&A == &B) return 0;
+        for (std::size_t Index = 0; Index < A.size() && Index < B.size(); ++Index) {
+          if (int Result = A[Index].first.as_string_view().compare(B[Index].first.as_string_view())) return Result < 0 ? -1 : 1;
+          if (int Result = totalOrder(A[Index].second, B[Index].second)) return Result;
+        }
+        return A.size() < B.size() ? -1 : A.size() > B.size() ? 1 : 0;
+      }
+      default: {
+        if (!First.value().is_inline() && First.data() == Second.data() && First.size() == Second.size()) return 0;
+        return std::string_view(reinterpret_cast<const char*>(First.data()), First.size()).compare(std::string_view(reinterpret_cast<const char*>(Second.data()), Second.size()));
+      }
+    }
+  }
+
+  /**
+   * Hash, equality and ordering of dynamic keys, all three agree with totalOrder():
+   * std::unordered_map<dynamic, T, dynamic::hasher, dynamic::key_equal> or std::map<dynamic, T, dynamic::key_less>.
+   * operator == compares by value across types ("42" equals 42) and NaN differs from itself, so it is not used for keys.
+   */
+  struct hasher {
+    std::size_t operator () (const dynamic & Value) const {return Value.hash();}
+  };
+
+  struct key_equal {
+    bool operator () (const dynamic & First, const dynamic & Second) const {return !totalOrder(First, Second);}
+  };
+
+  struct key_less {
+    bool operator () (const dynamic & First, const dynamic & Second) const {return totalOrder(First, Second) < 0;}
+  };
+
+  //! Payloads of at least this size cache their hash
+  static constexpr std::size_t cached_hash_size = 256;
+
   //! Get major type for two given dynamic variables
   static Type getMajorType(const dynamic & T0, const dynamic & T1) {
-    return Type::Undefined;
+    return promotion::major(T0, T1);
   }
 
   //! Resize container to fit new size
   void resize(std::size_t NewSize) {
     value_rw().resize(NewSize);
-    if (value().capacity() > NewSize) std::vector<std::uint8_t>().swap(value_rw());
+  }
+
+  //! Get memory resource used for heap storage
+  std::pmr::memory_resource * resource() const {
+    return value().resource();
+  }
+
+  //! Get heap capacity retention policy
+  CapacityPolicy capacityPolicy() const {
+    return value().policy();
+  }
+
+  //! Set heap capacity retention policy
+  void setCapacityPolicy(CapacityPolicy Policy) {
+    value_rw().set_policy(Policy);
+  }
+
+public:
+  //! Create empty Array with storage allocated from given memory resource
+  static dynamic array(std::pmr::memory_resource * Resource = nullptr) {
+    dynamic Result(Resource);
+    Result = array_type(Result.resource());
+    return Result;
+  }
+
+  //! Create empty Object with storage allocated from given memory resource
+  static dynamic object(std::pmr::memory_resource * Resource = nullptr) {
+    dynamic Result(Resource);
+    Result = object_type(Result.resource());
+    return Result;
+  }
+
+  //! Get number of Array elements or Object members, Undefined is empty
+  std::size_t length() const {
+    switch (type()) {
+      case Type::Undefined: return 0;
+      case Type::Array:     return elements().size();
+      case Type::Object:    return members().size();
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Access Array elements
+  const array_type & elements() const {
+    if (type() != Type::Array) throw std::bad_cast();
+    return value().container<array_type>();
+  }
+
+  //! Access Array elements, shared Array is copied first
+  array_type & elements() {
+    if (type() != Type::Array) throw std::bad_cast();
+    return value_rw().container<array_type>();
+  }
+
+  //! Access Object members sorted by key
+  const object_type & members() const {
+    if (type() != Type::Object) throw std::bad_cast();
+    return value().container<object_type>();
+  }
+
+  //! Access Array element without range check
+  const dynamic & operator [] (std::size_t Index) const {return elements()[Index];}
+  dynamic & operator [] (std::size_t Index)             {return elements()[Index];}
+
+  //! Access Array element, throws std::out_of_range for invalid index
+  const dynamic & at(std::size_t Index) const {return elements().at(Index);}
+  dynamic & at(std::size_t Index)             {return elements().at(Index);}
+
+  //! Append Array element, Undefined value becomes Array
+  void push_back(const dynamic & Value) {
+    // - Value may be this Array or its element, copy shares storage and forces private copy of the Array
+    dynamic Copy(Value);
+    push_back(std::move(Copy));
+  }
+
+  //! Append Array element, Undefined value becomes Array
+  void push_back(dynamic && Value) {
+    if (type() == Type::Undefined) *this = array_type(resource());
+    elements().push_back(std::move(Value));
+  }
+
+  //! Find Object member, returns null if key is not present
+  const dynamic * find(std::string_view Key) const {
+    const object_type & Members = members();
+    object_type::const_iterator Found = lowerBound(Members.begin(), Members.end(), Key);
+    return Found != Members.end() && Found->first.as_string_view() == Key ? &Found->second : nullptr;
+  }
+
+  //! Find Object member, returns null if key is not present
+  dynamic * find(std::string_view Key) {
+    if (!static_cast<const dynamic&>(*this).find(Key)) return nullptr;
+    object_type & Members = value_rw().container<object_type>();
+    return &lowerBound(Members.begin(), Members.end(), Key)->second;
+  }
+
+  //! Check is key present in Object
+  bool contains(std::string_view Key) const {
+    return find(Key) != nullptr;
+  }
+
+  //! Access Object member, throws std::out_of_range if key is not present
+  const dynamic & at(std::string_view Key) const {
+    if (const dynamic * Found = find(Key)) return *Found;
+    throw std::out_of_range("Key not found");
+  }
+
+  //! Access Object member, throws std::out_of_range if key is not present
+  dynamic & at(std::string_view Key) {
+    if (dynamic * Found = find(Key)) return *Found;
+    throw std::out_of_range("Key not found");
+  }
+
+  //! Access Object member, throws std::out_of_range if key is not present
+  const dynamic & operator [] (std::string_view Key) const  {return at(Key);}
+
+  //! Access Object member by C string key, template keeps literal 0 an Array index
+  template <typename T, typename = typename std::enable_if<std::is_same<typename std::remove_const<T>::type, char>::value>::type>
+  const dynamic & operator [] (T * Key) const {return at(std::string_view(Key));}
+
+  //! Access Object member, missing member is inserted as Undefined, Undefined value becomes Object
+  dynamic & operator [] (std::string_view Key) {
+    if (type() == Type::Undefined) *this = object_type(resource());
+    if (type() != Type::Object) throw std::bad_cast();
+    object_type & Members = value_rw().container<object_type>();
+    object_type::iterator Found = lowerBound(Members.begin(), Members.end(), Key);
+    if (Found != Members.end() && Found->first.as_string_view() == Key) return Found->second;
+
+    dynamic Name(resource());
+    Name.resize(Key.size());
+    if (!Key.empty()) std::memcpy(Name.data(), Key.data(), Key.size());
+    Name.setType(Type::String);
+    return Members.emplace(Found, std::move(Name), dynamic(resource()))->second;
+  }
+  template <typename T, typename = typename std::enable_if<std::is_same<typename std::remove_const<T>::type, char>::value>::type>
+  dynamic & operator [] (T * Key) {return (*this)[std::string_view(Key)];}
+
+  //! Remove Object member, returns false if key is not present
+  bool erase(std::string_view Key) {
+    if (!contains(Key)) return false;
+    object_type & Members = value_rw().container<object_type>();
+    Members.erase(lowerBound(Members.begin(), Members.end(), Key));
+    return true;
   }
 
 private:
@@ -430,85 +1892,605 @@ private:
   }
 
   //! Access to value container in R/W mode
-  std::vector<std::uint8_t> & value_rw() {
+  buffer & value_rw() {
     return _Value;
   }
 
   //! Get stored type as numeric type
   template <typename T>
   T asNumeric() const {
+    statistics::conversion Probe(type(), statistics::target<T>());
+    T Result;
+    if (!tryNumeric(Result)) throw std::bad_cast();
+    return Result;
+  }
+
+  //! Get stored type as numeric type, returns false when value can not be converted
+  template <typename T>
+  bool tryNumeric(T & Result) const noexcept {
     switch (type()) {
-      // --- Cast from undefined
-      case Type::Undefined: throw std::bad_cast();
+      // --- Cast from undefined, Array or Object
+      case Type::Undefined:
+      case Type::Array:
+      case Type::Object: return false;
       // --- Cast from signed integer
       case Type::SignedInt: {
         switch (size()) {
-          case sizeof(std::int8_t):   return *reinterpret_cast<const std::int8_t*>(data());
-          case sizeof(std::int16_t):  return *reinterpret_cast<const std::int16_t*>(data());
-          case sizeof(std::int32_t):  return *reinterpret_cast<const std::int16_t*>(data());
-          case sizeof(std::int64_t):  return *reinterpret_cast<const std::int16_t*>(data());
-          default: throw std::bad_cast();
+          case sizeof(std::int8_t):   return narrow<std::int64_t>(*reinterpret_cast<const std::int8_t*>(data()), Result);
+          case sizeof(std::int16_t):  return narrow<std::int64_t>(*reinterpret_cast<const std::int16_t*>(data()), Result);
+          case sizeof(std::int32_t):  return narrow<std::int64_t>(*reinterpret_cast<const std::int32_t*>(data()), Result);
+          case sizeof(std::int64_t):  return narrow<std::int64_t>(*reinterpret_cast<const std::int64_t*>(data()), Result);
+          default: return false;
         }
       }; break;
       // --- Cast from unsigned integer
       case Type::UnsignedInt: {
         switch (size()) {
-          case sizeof(std::uint8_t):    return *reinterpret_cast<const std::uint8_t*>(data());
-          case sizeof(std::uint16_t):   return *reinterpret_cast<const std::uint16_t*>(data());
-          case sizeof(std::uint32_t):   return *reinterpret_cast<const std::uint32_t*>(data());
-          case sizeof(std::uint64_t):   return *reinterpret_cast<const std::uint64_t*>(data());
-          default: throw std::bad_cast();
+          case sizeof(std::uint8_t):    return narrow<std::uint64_t>(*reinterpret_cast<const std::uint8_t*>(data()), Result);
+          case sizeof(std::uint16_t):   return narrow<std::uint64_t>(*reinterpret_cast<const std::uint16_t*>(data()), Result);
+          case sizeof(std::uint32_t):   return narrow<std::uint64_t>(*reinterpret_cast<const std::uint32_t*>(data()), Result);
+          case sizeof(std::uint64_t):   return narrow<std::uint64_t>(*reinterpret_cast<const std::uint64_t*>(data()), Result);
+          default: return false;
         }
       }; break;
       // --- Cast from float
       case Type::Float: {
         // - Determine correct float type
-        if (size() == sizeof(float))        return *reinterpret_cast<const float*>(data());
-        else if (size() == sizeof(double))  return *reinterpret_cast<const double*>(data());
-        else throw std::bad_cast();
+        if (size() == sizeof(float))        return narrow<double>(*reinterpret_cast<const float*>(data()), Result);
+        else if (size() == sizeof(double))  return narrow<double>(*reinterpret_cast<const double*>(data()), Result);
+        return false;
       }; break;
       // --- Cast from string
       case Type::String: {
-        std::string src(reinterpret_cast<const char*>(data()), size());
-        switch (sizeof(T)) {
-          case 1:
-          case 2:
-          case 4: {
-            std::int32_t Result = 0;
-            sscanf(src.c_str(), "%d", &Result);
-            return static_cast<T>(Result);
-          }; break;
-          case 8: {
-            std::int64_t Result = 0;
-            sscanf(src.c_str(), "%ld", &Result);
-            return static_cast<T>(Result);
-          }; break;
-        }
-
-        //std::istringstream iss(std::string(reinterpret_cast<const char*>(data()), size()));
-        //T Result = 0;
-        //iss >> Result;
-        //return Result;
+        return parseNumeric(reinterpret_cast<const char*>(data()), reinterpret_cast<const char*>(data()) + size(), Result);
       }; break;
       // --- Cast from binary data
       #ifdef __DYNAMIC__WITH_UUIDPP__
       case Type::UUID:
       #endif
       case Type::Binary: {
-        if (size() > sizeof(T)) throw std::bad_cast();
-        T Result = 0;
-        copyTo(reinterpret_cast<std::uint8_t*>(&Result), sizeof(T), std::min(sizeof(T), size()));
-        return Result;
+        if (size() > sizeof(T)) return false;
+        Result = 0;
+        std::copy_n(data(), size(), reinterpret_cast<std::uint8_t*>(&Result));
+        return true;
       }; break;
     }
-    throw std::bad_cast();
+    return false;
+  }
+
+  //! Parse numeric value from text, locale independent, returns false when text is not a number of type T
+  template <typename T>
+  static bool parseNumeric(const char * First, const char * Last, T & Result) noexcept {
+    // - Skip surrounding whitespaces and plus sign of positive number
+    while (First != Last && std::isspace(static_cast<unsigned char>(*First))) ++First;
+    while (First != Last && std::isspace(static_cast<unsigned char>(Last[-1]))) --Last;
+    if (First != Last && *First == '+') {
+      if (++First != Last && *First == '-') return false;
+    }
+
+    if constexpr (std::is_same<T, bool>::value) {
+      // - Any number other than zero is true, as for numeric values
+      double Value;
+      if (!parseNumeric(First, Last, Value)) return false;
+      Result = Value != 0;
+      return true;
+    } else {
+      // - Parsed in requested type, so out of range value fails instead of wrapping, whole text must be consumed
+      Result = 0;
+      std::from_chars_result Parsed = std::from_chars(First, Last, Result);
+      return Parsed.ec == std::errc() && Parsed.ptr == Last;
+    }
+  }
+
+  //! Parse boolean literal, case insensitive, without copying the text
+  static bool parseBool(std::string_view Text) {
+    bool Result;
+    if (!parseBool(Text, Result)) throw std::bad_cast();
+    return Result;
+  }
+
+  //! Parse boolean literal, returns false when text is not a boolean literal
+  static bool parseBool(std::string_view Text, bool & Result) noexcept {
+    static constexpr std::string_view True[]  = {"true", "yes", "1", "on", "enabled"};
+    static constexpr std::string_view False[] = {"false", "no", "0", "off", "disabled"};
+    auto Matches = [Text](std::string_view Literal) {
+      return Literal.size() == Text.size() && std::equal(Literal.begin(), Literal.end(), Text.begin(), [](char First, char Second) {
+        return First == std::tolower(static_cast<unsigned char>(Second));
+      });
+    };
+    for (std::string_view Literal : True)   if (Matches(Literal)) {Result = true;  return true;}
+    for (std::string_view Literal : False)  if (Matches(Literal)) {Result = false; return true;}
+    return false;
+  }
+
+  //! Format numeric value as text, locale independent
+  template <typename T>
+  static std::size_t formatNumeric(char * Buffer, std::size_t BufferSize, T Value) {
+    std::to_chars_result Formatted = std::to_chars(Buffer, Buffer + BufferSize, Value);
+    if (Formatted.ec != std::errc()) throw std::overflow_error("Buffer to small");
+    return static_cast<std::size_t>(Formatted.ptr - Buffer);
+  }
+
+  //! Arithmetic operation
+  enum class Operation {Add, Subtract, Multiply, Divide, Modulo};
+
+  /**
+   * @brief Type promotion engine for comparison and arithmetic
+   *
+   * Both operands are promoted to common (Type, width) and the operation is applied on native values.
+   * Handlers for every pair of kinds are generated at compile time, so dispatch is one table lookup.
+   * Promotion rules:
+   *  - integers of the same signedness promote to the wider width, mixed signedness to a signed type
+   *    wide enough for both (up to 64 bit), comparison of mixed signedness is exact
+   *  - float is kept only with float or integers up to 16 bit, double otherwise
+   *  - String against a number is parsed as a number
+   *  - String and Binary compare bytewise, + concatenates them
+   *  - Arrays and Objects compare lexicographically, + concatenates Arrays
+   *  - Undefined is less than any value and is identity for +
+   */
+  struct promotion {
+    //! Three-way comparison results
+    static constexpr int less       = -1;
+    static constexpr int equal      = 0;
+    static constexpr int greater    = 1;
+    static constexpr int unordered  = 2;
+
+    //! Number of kinds
+    static constexpr std::size_t count = static_cast<std::size_t>(Kind::Count);
+
+    //! Native type of kind
+    struct none {};
+    template <Kind K>
+    using native = typename std::tuple_element<static_cast<std::size_t>(K), std::tuple<
+      none,
+      std::int8_t, std::int16_t, std::int32_t, std::int64_t,
+      std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t,
+      float, double,
+      std::string_view,
+      std::string_view,
+      none, none,
+      none
+    >>::type;
+
+    template <Kind K>
+    static constexpr bool numeric = K >= Kind::Int8 && K <= Kind::Float64;
+
+    template <Kind K>
+    static constexpr bool text = K == Kind::String || K == Kind::Binary;
+
+    template <Kind K>
+    static constexpr bool container = K == Kind::Array || K == Kind::Object;
+
+    //! Integer type of given width
+    template <std::size_t Width, bool Signed>
+    using integer = typename std::tuple_element<Width == 1 ? 0 : Width == 2 ? 1 : Width == 4 ? 2 : 3, typename std::conditional<Signed,
+      std::tuple<std::int8_t, std::int16_t, std::int32_t, std::int64_t>,
+      std::tuple<std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t>
+    >::type>::type;
+
+    //! Width of signed type able to hold all values of given type
+    template <typename T>
+    static constexpr std::size_t signedWidth() {
+      return std::is_signed<T>::value ? sizeof(T) : std::min<std::size_t>(sizeof(T) * 2, sizeof(std::int64_t));
+    }
+
+    //! Check is float precise enough for given type
+    template <typename T>
+    static constexpr bool fitsFloat() {
+      return std::is_same<T, float>::value || (std::is_integral<T>::value && sizeof(T) <= sizeof(std::int16_t));
+    }
+
+    //! Common type of two native numeric types
+    template <typename A, typename B>
+    using common = typename std::conditional<std::is_floating_point<A>::value || std::is_floating_point<B>::value,
+      typename std::conditional<fitsFloat<A>() && fitsFloat<B>(), float, double>::type,
+      typename std::conditional<std::is_unsigned<A>::value && std::is_unsigned<B>::value,
+        integer<std::max(sizeof(A), sizeof(B)), false>,
+        integer<std::max(signedWidth<A>(), signedWidth<B>()), true>
+      >::type
+    >::type;
+
+    //! Load native value of given kind
+    template <Kind K>
+    static native<K> load(const dynamic & Value) {
+      if constexpr (numeric<K>) {
+        native<K> Result;
+        std::memcpy(&Result, Value.data(), sizeof(Result));
+        return Result;
+      } else if constexpr (text<K>) {
+        return std::string_view(reinterpret_cast<const char*>(Value.data()), Value.size());
+      } else {
+        return native<K>();
+      }
+    }
+
+    //! Get stored type of kind
+    static constexpr Type typeOf(Kind K) {
+      return K >= Kind::Int8 && K <= Kind::Int64    ? Type::SignedInt :
+             K >= Kind::UInt8 && K <= Kind::UInt64  ? Type::UnsignedInt :
+             K >= Kind::Float32 && K <= Kind::Float64 ? Type::Float :
+             K == Kind::String ? Type::String :
+             K == Kind::Binary ? Type::Binary :
+             K == Kind::Array ? Type::Array :
+             K == Kind::Object ? Type::Object : Type::Undefined;
+    }
+
+    //! Get stored type of native numeric type
+    template <typename T>
+    static constexpr Type typeOf() {
+      return std::is_floating_point<T>::value ? Type::Float : std::is_signed<T>::value ? Type::SignedInt : Type::UnsignedInt;
+    }
+
+    //! Three-way comparison of native values
+    template <typename T>
+    static int order(T First, T Second) {
+      if (First < Second) return less;
+      if (Second < First) return greater;
+      return First == Second ? equal : unordered;
+    }
+
+    //! Check is native value negative
+    template <typename T>
+    static bool negative(T Value) {
+      if constexpr (std::is_signed<T>::value) return Value < 0;
+      else return false;
+    }
+
+    //! Exact three-way comparison of integers of any signedness
+    template <typename A, typename B>
+    static int orderIntegers(A First, B Second) {
+      if (negative(First) != negative(Second)) return negative(First) ? less : greater;
+      if (negative(First)) return order<std::int64_t>(First, Second);
+      return order<std::uint64_t>(First, Second);
+    }
+
+    //! Apply arithmetic operation on native values
+    template <Operation Op, typename T>
+    static T calculate(T First, T Second) {
+      if constexpr (std::is_floating_point<T>::value) {
+        if constexpr (Op == Operation::Add)           return First + Second;
+        else if constexpr (Op == Operation::Subtract) return First - Second;
+        else if constexpr (Op == Operation::Multiply) return First * Second;
+        else if constexpr (Op == Operation::Divide)   return First / Second;
+        else                                          return std::fmod(First, Second);
+      } else {
+        // - Integers wrap around in their width
+        typedef std::uint64_t Wide;
+        if constexpr (Op == Operation::Add)           return static_cast<T>(static_cast<Wide>(First) + static_cast<Wide>(Second));
+        else if constexpr (Op == Operation::Subtract) return static_cast<T>(static_cast<Wide>(First) - static_cast<Wide>(Second));
+        else if constexpr (Op == Operation::Multiply) return static_cast<T>(static_cast<Wide>(First) * static_cast<Wide>(Second));
+        else {
+          if (!Second) throw std::domain_error("Division by zero");
+          if constexpr (std::is_signed<T>::value) {
+            if (Second == -1) return Op == Operation::Divide ? static_cast<T>(Wide(0) - static_cast<Wide>(First)) : T(0);
+          }
+          return static_cast<T>(Op == Operation::Divide ? First / Second : First % Second);
+        }
+      }
+    }
+
+    //! Convert text to numeric value, integers are preferred over floating point
+    static dynamic number(std::string_view Text) {
+      const char * First  = Text.data();
+      const char * Last   = First + Text.size();
+      while (First != Last && std::isspace(static_cast<unsigned char>(*First))) ++First;
+      if (First != Last && *First == '+') ++First;
+
+      std::int64_t Signed;
+      std::from_chars_result Parsed = std::from_chars(First, Last, Signed);
+      if (Parsed.ec == std::errc() && Parsed.ptr == Last) return Signed;
+
+      std::uint64_t Unsigned;
+      Parsed = std::from_chars(First, Last, Unsigned);
+      if (Parsed.ec == std::errc() && Parsed.ptr == Last) return Unsigned;
+
+      double Float;
+      Parsed = std::from_chars(First, Last, Float);
+      if (Parsed.ec == std::errc() && Parsed.ptr == Last) return Float;
+
+      throw std::bad_cast();
+    }
+
+    //! Lexicographic comparison of Arrays or Objects, Object members are compared by key, then value
+    template <Kind K>
+    static int compareContainers(const dynamic & First, const dynamic & Second) {
+      if constexpr (K == Kind::Array) {
+        const array_type & A = First.elements(), & B = Second.elements();
+        for (std::size_t Index = 0; Index < A.size() && Index < B.size(); ++Index) {
+          int Result = compare(A[Index], B[Index]);
+          if (Result != equal) return Result;
+        }
+        return order(A.size(), B.size());
+      } else {
+        const object_type & A = First.members(), & B = Second.members();
+        for (std::size_t Index = 0; Index < A.size() && Index < B.size(); ++Index) {
+          int Result = A[Index].first.as_string_view().compare(B[Index].first.as_string_view());
+          if (Result) return Result < 0 ? less : greater;
+          Result = compare(A[Index].second, B[Index].second);
+          if (Result != equal) return Result;
+        }
+        return order(A.size(), B.size());
+      }
+    }
+
+    //! Concatenate two Arrays
+    static dynamic concatenate(const array_type & First, const array_type & Second) {
+      array_type Result(First.get_allocator());
+      Result.reserve(First.size() + Second.size());
+      Result.insert(Result.end(), First.begin(), First.end());
+      Result.insert(Result.end(), Second.begin(), Second.end());
+      return dynamic(std::move(Result));
+    }
+
+    //! Concatenate two payloads
+    static dynamic concatenate(std::string_view First, std::string_view Second, Type StoredType) {
+      dynamic Result;
+      Result.resize(First.size() + Second.size());
+      std::copy(First.begin(), First.end(), Result.data());
+      std::copy(Second.begin(), Second.end(), Result.data() + First.size());
+      Result.setType(StoredType);
+      return Result;
+    }
+
+    //! Compare values of given kinds
+    template <Kind A, Kind B>
+    static int compareAs(const dynamic & First, const dynamic & Second) {
+      if constexpr (A == Kind::Invalid || B == Kind::Invalid) {
+        throw std::bad_cast();
+      } else if constexpr (A == Kind::Undefined || B == Kind::Undefined) {
+        return order(A != Kind::Undefined, B != Kind::Undefined);
+      } else if constexpr (numeric<A> && numeric<B>) {
+        typedef common<native<A>, native<B>> C;
+        if constexpr (std::is_integral<C>::value) return orderIntegers(load<A>(First), load<B>(Second));
+        else return order(static_cast<C>(load<A>(First)), static_cast<C>(load<B>(Second)));
+      } else if constexpr (text<A> && text<B>) {
+        int Result = load<A>(First).compare(load<B>(Second));
+        return Result < 0 ? less : Result > 0 ? greater : equal;
+      } else if constexpr (container<A> && A == B) {
+        return compareContainers<A>(First, Second);
+      } else if constexpr (numeric<A> && B == Kind::String) {
+        return compare(First, number(load<B>(Second)));
+      } else if constexpr (A == Kind::String && numeric<B>) {
+        return compare(number(load<A>(First)), Second);
+      } else {
+        throw std::bad_cast();
+      }
+    }
+
+    //! Apply arithmetic operation on values of given kinds
+    template <Operation Op, Kind A, Kind B>
+    static dynamic applyAs(const dynamic & First, const dynamic & Second) {
+      if constexpr (A == Kind::Invalid || B == Kind::Invalid) {
+        throw std::bad_cast();
+      } else if constexpr (Op == Operation::Add && B == Kind::Undefined) {
+        return First;
+      } else if constexpr (Op == Operation::Add && A == Kind::Undefined) {
+        return Second;
+      } else if constexpr (numeric<A> && numeric<B>) {
+        typedef common<native<A>, native<B>> C;
+        return calculate<Op, C>(static_cast<C>(load<A>(First)), static_cast<C>(load<B>(Second)));
+      } else if constexpr (Op == Operation::Add && text<A> && text<B>) {
+        return concatenate(load<A>(First), load<B>(Second), A == Kind::String && B == Kind::String ? Type::String : Type::Binary);
+      } else if constexpr (Op == Operation::Add && A == Kind::Array && B == Kind::Array) {
+        return concatenate(First.elements(), Second.elements());
+      } else if constexpr (numeric<A> && B == Kind::String) {
+        return apply<Op>(First, number(load<B>(Second)));
+      } else if constexpr (A == Kind::String && numeric<B>) {
+        return apply<Op>(number(load<A>(First)), Second);
+      } else {
+        throw std::bad_cast();
+      }
+    }
+
+    //! Get major type for values of given kinds
+    template <Kind A, Kind B>
+    static constexpr Type majorAs() {
+      if constexpr (A == Kind::Invalid || B == Kind::Invalid) return Type::Undefined;
+      else if constexpr (A == Kind::Undefined) return typeOf(B);
+      else if constexpr (B == Kind::Undefined) return typeOf(A);
+      else if constexpr (numeric<A> && numeric<B>) return typeOf<common<native<A>, native<B>>>();
+      else if constexpr (numeric<A> && B == Kind::String) return typeOf(A);
+      else if constexpr (A == Kind::String && numeric<B>) return typeOf(B);
+      else if constexpr (text<A> && text<B>) return A == Kind::String && B == Kind::String ? Type::String : Type::Binary;
+      else if constexpr (container<A> && A == B) return typeOf(A);
+      else return Type::Undefined;
+    }
+
+    typedef int     (*compare_function)(const dynamic &, const dynamic &);
+    typedef dynamic (*apply_function)(const dynamic &, const dynamic &);
+
+    template <std::size_t... I>
+    static constexpr std::array<compare_function, sizeof...(I)> compareTable(std::index_sequence<I...>) {
+      return {{&compareAs<static_cast<Kind>(I / count), static_cast<Kind>(I % count)>...}};
+    }
+
+    template <Operation Op, std::size_t... I>
+    static constexpr std::array<apply_function, sizeof...(I)> applyTable(std::index_sequence<I...>) {
+      return {{&applyAs<Op, static_cast<Kind>(I / count), static_cast<Kind>(I % count)>...}};
+    }
+
+    template <std::size_t... I>
+    static constexpr std::array<Type, sizeof...(I)> majorTable(std::index_sequence<I...>) {
+      return {{majorAs<static_cast<Kind>(I / count), static_cast<Kind>(I % count)>()...}};
+    }
+
+    //! Get table index for pair of values
+    static std::size_t index(const dynamic & First, const dynamic & Second) {
+      return static_cast<std::size_t>(First.kind()) * count + static_cast<std::size_t>(Second.kind());
+    }
+
+    //! Three-way comparison of two values
+    static int compare(const dynamic & First, const dynamic & Second) {
+      static constexpr std::array<compare_function, count * count> Table = compareTable(std::make_index_sequence<count * count>());
+      return Table[index(First, Second)](First, Second);
+    }
+
+    //! Apply arithmetic operation on two values
+    template <Operation Op>
+    static dynamic apply(const dynamic & First, const dynamic & Second) {
+      static constexpr std::array<apply_function, count * count> Table = applyTable<Op>(std::make_index_sequence<count * count>());
+      return Table[index(First, Second)](First, Second);
+    }
+
+    //! Get major type of two values
+    static Type major(const dynamic & First, const dynamic & Second) {
+      static constexpr std::array<Type, count * count> Table = majorTable(std::make_index_sequence<count * count>());
+      return Table[index(First, Second)];
+    }
+  };
+
+  //! Numeric value widened to 64 bit
+  struct number {
+    enum Category {Integer, Natural, Floating} Class;
+    std::int64_t  Signed;
+    std::uint64_t Unsigned;
+    double        Float;
+  };
+
+  //! Get stored numeric value widened to 64 bit
+  number toNumber() const {
+    number Result = {number::Integer, 0, 0, 0};
+    switch (kind()) {
+      case Kind::Int8:    Result.Signed = promotion::load<Kind::Int8>(*this); break;
+      case Kind::Int16:   Result.Signed = promotion::load<Kind::Int16>(*this); break;
+      case Kind::Int32:   Result.Signed = promotion::load<Kind::Int32>(*this); break;
+      case Kind::Int64:   Result.Signed = promotion::load<Kind::Int64>(*this); break;
+      case Kind::UInt8:   Result.Class = number::Natural; Result.Unsigned = promotion::load<Kind::UInt8>(*this); break;
+      case Kind::UInt16:  Result.Class = number::Natural; Result.Unsigned = promotion::load<Kind::UInt16>(*this); break;
+      case Kind::UInt32:  Result.Class = number::Natural; Result.Unsigned = promotion::load<Kind::UInt32>(*this); break;
+      case Kind::UInt64:  Result.Class = number::Natural; Result.Unsigned = promotion::load<Kind::UInt64>(*this); break;
+      case Kind::Float32: Result.Class = number::Floating; Result.Float = promotion::load<Kind::Float32>(*this); break;
+      case Kind::Float64: Result.Class = number::Floating; Result.Float = promotion::load<Kind::Float64>(*this); break;
+      default: throw std::bad_cast();
+    }
+    return Result;
+  }
+
+  //! Exact comparison of widened numbers, NaN is greater than any number and equal to NaN
+  static int compareNumbers(const number & First, const number & Second) {
+    if (First.Class == number::Floating && Second.Class == number::Floating) {
+      bool FirstNaN = std::isnan(First.Float), SecondNaN = std::isnan(Second.Float);
+      if (FirstNaN || SecondNaN) return FirstNaN - SecondNaN;
+      return First.Float < Second.Float ? -1 : First.Float > Second.Float ? 1 : 0;
+    }
+    if (Second.Class == number::Floating) return -compareNumbers(Second, First);
+    if (First.Class == number::Floating) {
+      // - Compare integral part as integer, then fractional part
+      if (std::isnan(First.Float) || First.Float >= 18446744073709551616.0) return 1;
+      if (First.Float < -9223372036854775808.0) return -1;
+      double  Integral  = std::trunc(First.Float);
+      number  Truncated = Integral < 0 ? number{number::Integer, static_cast<std::int64_t>(Integral), 0, 0} : number{number::Natural, 0, static_cast<std::uint64_t>(Integral), 0};
+      int     Result    = compareNumbers(Truncated, Second);
+      if (Result) return Result;
+      return First.Float > Integral ? 1 : First.Float < Integral ? -1 : 0;
+    }
+    if (First.Class == number::Integer) {
+      if (Second.Class == number::Integer) return promotion::orderIntegers(First.Signed, Second.Signed);
+      return promotion::orderIntegers(First.Signed, Second.Unsigned);
+    }
+    if (Second.Class == number::Integer) return promotion::orderIntegers(First.Unsigned, Second.Signed);
+    return promotion::orderIntegers(First.Unsigned, Second.Unsigned);
+  }
+
+  //! Rank of String in total order
+  static constexpr int string_rank = 2;
+
+  //! Rank of value in total order: Undefined, numbers, String, Binary, Array, Object
+  int rank() const {
+    switch (kind()) {
+      case Kind::Undefined: return 0;
+      case Kind::String:    return string_rank;
+      case Kind::Binary:
+      case Kind::Invalid:   return 3;
+      case Kind::Array:     return 4;
+      case Kind::Object:    return 5;
+      default:              return 1;
+    }
+  }
+
+  //! Finalize 64 bit hash
+  static std::uint64_t mix(std::uint64_t Value) {
+    Value ^= Value >> 33;
+    Value *= 0xFF51AFD7ED558CCDull;
+    Value ^= Value >> 33;
+    Value *= 0xC4CEB9FE1A85EC53ull;
+    Value ^= Value >> 33;
+    return Value;
+  }
+
+  //! Hash raw bytes eight at a time, never returns zero
+  static std::uint64_t hashBytes(const std::uint8_t * Data, std::size_t Size, std::uint64_t Seed) {
+    std::uint64_t Result = Seed ^ (Size * 0x9E3779B97F4A7C15ull);
+    for (; Size >= sizeof(std::uint64_t); Data += sizeof(std::uint64_t), Size -= sizeof(std::uint64_t)) {
+      std::uint64_t Word;
+      std::memcpy(&Word, Data, sizeof(Word));
+      Result ^= Word * 0x9E3779B97F4A7C15ull;
+      Result  = ((Result << 31) | (Result >> 33)) * 0xC2B2AE3D27D4EB4Full;
+    }
+    if (Size) {
+      std::uint64_t Word = 0;
+      std::memcpy(&Word, Data, Size);
+      Result ^= Word * 0x9E3779B97F4A7C15ull;
+    }
+    Result = mix(Result);
+    return Result ? Result : 1;
+  }
+
+  //! Compare text representation with given string, String and Binary payloads are compared in place
+  int compareText(std::string_view Second) const {
+    switch (type()) {
+      case Type::Undefined:
+      case Type::String:
+      case Type::Binary:
+        return as_string_view().compare(Second);
+      case Type::SignedInt:
+      case Type::UnsignedInt:
+      case Type::Float: {
+        char Buffer[max_numeric_length];
+        return std::string_view(Buffer, format_to(Buffer, sizeof(Buffer))).compare(Second);
+      }
+      default:
+        return cast<std::string>().compare(Second);
+    }
+  }
+
+  //! Find first Object member with key not less than given one
+  template <typename Iterator>
+  static Iterator lowerBound(Iterator First, Iterator Last, std::string_view Key) {
+    return std::lower_bound(First, Last, Key, [](const member & Member, std::string_view Name) {
+      return Member.first.as_string_view() < Name;
+    });
+  }
+
+  //! Sort Object members by key, of members with equal keys the last one is kept
+  static void sortMembers(object_type & Members) {
+    auto Less = [](const member & First, const member & Second) {
+      return First.first.as_string_view() < Second.first.as_string_view();
+    };
+    if (Members.size() <= 16) {
+      // - Insertion sort, small objects are sorted without temporary buffer of std::stable_sort
+      for (object_type::iterator Member = Members.begin(); Member != Members.end(); ++Member) {
+        std::rotate(std::upper_bound(Members.begin(), Member, *Member, Less), Member, Member + 1);
+      }
+    } else if (!std::is_sorted(Members.begin(), Members.end(), Less)) {
+      std::stable_sort(Members.begin(), Members.end(), Less);
+    }
+
+    object_type::iterator Output = Members.begin();
+    for (object_type::iterator Input = Members.begin(); Input != Members.end(); ++Input) {
+      object_type::iterator Next = Input + 1;
+      if (Next != Members.end() && Next->first.as_string_view() == Input->first.as_string_view()) continue;
+      if (Output != Input) *Output = std::move(*Input);
+      ++Output;
+    }
+    Members.erase(Output, Members.end());
   }
 
   //! Store numeric value
   template <typename T>
   void storeNumeric(const T Value, Type StoredType) {
     resize(sizeof(T));
-    value_rw().assign(reinterpret_cast<const std::uint8_t*>(&Value), reinterpret_cast<const std::uint8_t*>(&Value) + sizeof(T));
+    std::memcpy(value_rw().data(), &Value, sizeof(T));
     setType(StoredType);
   }
 
@@ -519,12 +2501,8 @@ public:
   }
 private:
   //! Raw data buffer
-  std::vector<std::uint8_t> _Value;
+  buffer                    _Value;
 
   //! Stored type
   Type                      _StoredType;
-
-  //! Mutex
-  std::mutex                _Mutex;
 };
-
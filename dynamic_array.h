@@ -0,0 +1,496 @@
+/*
+ * DYNAMIC_ARRAY is columnar container for dynamic values
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include "dynamic.h"
+
+// - Autodetect AVX2 capability
+#ifdef __AVX2__
+  #include <immintrin.h>
+  #define __DYNAMIC_ARRAY__WITH_AVX2__
+#endif
+
+/**
+ * @brief Columnar container of dynamic values
+ *
+ * Column is stored as array of kind tags plus array of 64 bit slots: integers are kept widened to
+ * int64/uint64, floats to double, String and Binary payloads (under 4 GiB each) are appended to a
+ * single arena and slot keeps their offset. Bulk kernels run over the slot array directly, homogeneous columns take
+ * vectorized fast paths, mixed columns fall back to the dynamic promotion rules.
+ * Values are converted back to dynamic with their original kind (UUID is returned as Binary).
+ */
+class dynamic_array {
+public:
+  typedef dynamic::Kind Kind;
+
+  //! Comparison predicate for bulk compare
+  enum class Predicate {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+  };
+
+  //! Result of bulk compare, one bit per row
+  class bitmask {
+  public:
+    bitmask() : _Size(0) {}
+    explicit bitmask(std::size_t Size, bool Value = false) : _Words((Size + 63) / 64, Value ? ~std::uint64_t(0) : 0), _Size(Size) {trim();}
+
+    //! Get number of bits
+    std::size_t size() const {return _Size;}
+
+    //! Get bit
+    bool test(std::size_t Index) const {return (_Words[Index / 64] >> (Index % 64)) & 1;}
+
+    //! Set bit
+    void set(std::size_t Index, bool Value = true) {
+      if (Value) _Words[Index / 64] |= std::uint64_t(1) << (Index % 64);
+      else _Words[Index / 64] &= ~(std::uint64_t(1) << (Index % 64));
+    }
+
+    //! Count set bits
+    std::size_t count() const {
+      std::size_t Result = 0;
+      for (std::uint64_t Word : _Words) Result += static_cast<std::size_t>(__builtin_popcountll(Word));
+      return Result;
+    }
+
+    //! Access packed words
+    const std::uint64_t * data() const  {return _Words.data();}
+    std::uint64_t * data()              {return _Words.data();}
+
+    bitmask operator & (const bitmask & Second) const {
+      bitmask Result(*this);
+      for (std::size_t i = 0; i < Result._Words.size(); ++i) Result._Words[i] &= Second._Words[i];
+      return Result;
+    }
+
+    bitmask operator | (const bitmask & Second) const {
+      bitmask Result(*this);
+      for (std::size_t i = 0; i < Result._Words.size(); ++i) Result._Words[i] |= Second._Words[i];
+      return Result;
+    }
+
+    bitmask operator ~ () const {
+      bitmask Result(*this);
+      for (std::uint64_t & Word : Result._Words) Word = ~Word;
+      Result.trim();
+      return Result;
+    }
+
+  private:
+    //! Clear bits past the end
+    void trim() {
+      if (_Size % 64) _Words.back() &= (std::uint64_t(1) << (_Size % 64)) - 1;
+    }
+
+    std::vector<std::uint64_t>  _Words;
+    std::size_t                 _Size;
+  };
+
+public:
+  dynamic_array() : _Counts() {}
+
+  template <typename Iterator>
+  dynamic_array(Iterator First, Iterator Last) : _Counts() {
+    for (; First != Last; ++First) push_back(*First);
+  }
+
+  explicit dynamic_array(const std::vector<dynamic> & Values) : dynamic_array(Values.begin(), Values.end()) {}
+
+public:
+  //! Get number of rows
+  std::size_t size() const {return _Kinds.size();}
+
+  //! Check is array empty
+  bool empty() const {return _Kinds.empty();}
+
+  //! Reserve space for given number of rows
+  void reserve(std::size_t Count) {
+    _Kinds.reserve(Count);
+    _Slots.reserve(Count);
+    _Sizes.reserve(Count);
+  }
+
+  //! Remove all rows
+  void clear() {
+    _Kinds.clear();
+    _Slots.clear();
+    _Sizes.clear();
+    _Arena.clear();
+    std::fill(std::begin(_Counts), std::end(_Counts), 0);
+  }
+
+  //! Get kind of row
+  Kind kind(std::size_t Index) const {return _Kinds[Index];}
+
+  //! Append value
+  void push_back(const dynamic & Value) {
+    Kind          K     = Value.kind();
+    slot          Slot;
+    std::uint32_t Size  = 0;
+    Slot.Unsigned = 0;
+    switch (category(K)) {
+      case Category::Null:      break;
+      case Category::Signed:    Slot.Signed   = Value.cast<std::int64_t>(); break;
+      case Category::Unsigned:  Slot.Unsigned = Value.cast<std::uint64_t>(); break;
+      case Category::Float:     Slot.Float    = Value.cast<double>(); break;
+      case Category::Text:
+        // - Sizes are kept in 32 bit to keep the column compact
+        if (Value.size() > std::numeric_limits<std::uint32_t>::max()) throw std::length_error("Value too large");
+        Slot.Unsigned = _Arena.size();
+        Size = static_cast<std::uint32_t>(Value.size());
+        _Arena.insert(_Arena.end(), Value.data(), Value.data() + Value.size());
+        break;
+      default: throw std::bad_cast();
+    }
+    _Kinds.push_back(K);
+    _Slots.push_back(Slot);
+    _Sizes.push_back(Size);
+    ++_Counts[static_cast<std::size_t>(category(K))];
+  }
+
+  //! Get value of row
+  dynamic get(std::size_t Index) const {
+    const slot & Slot = _Slots[Index];
+    switch (_Kinds[Index]) {
+      case Kind::Int8:    return static_cast<std::int8_t>(Slot.Signed);
+      case Kind::Int16:   return static_cast<std::int16_t>(Slot.Signed);
+      case Kind::Int32:   return static_cast<std::int32_t>(Slot.Signed);
+      case Kind::Int64:   return Slot.Signed;
+      case Kind::UInt8:   return static_cast<std::uint8_t>(Slot.Unsigned);
+      case Kind::UInt16:  return static_cast<std::uint16_t>(Slot.Unsigned);
+      case Kind::UInt32:  return static_cast<std::uint32_t>(Slot.Unsigned);
+      case Kind::UInt64:  return Slot.Unsigned;
+      case Kind::Float32: return static_cast<float>(Slot.Float);
+      case Kind::Float64: return Slot.Float;
+      case Kind::String:
+      case Kind::Binary: {
+        dynamic Result;
+        Result.resize(_Sizes[Index]);
+        std::memcpy(Result.data(), _Arena.data() + Slot.Unsigned, _Sizes[Index]);
+        Result.setType(_Kinds[Index] == Kind::String ? dynamic::Type::String : dynamic::Type::Binary);
+        return Result;
+      }
+      default: return dynamic();
+    }
+  }
+
+  //! Get value of row
+  dynamic operator [] (std::size_t Index) const {return get(Index);}
+
+  //! Convert all rows to dynamic values
+  std::vector<dynamic> values() const {
+    std::vector<dynamic> Result;
+    Result.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) Result.push_back(get(i));
+    return Result;
+  }
+
+public:
+  //! Cast all rows to numeric type, output must have room for size() values
+  template <typename T>
+  void cast(T * Output) const {
+    const std::size_t Count = size();
+    if (uniform(Category::Signed)) {
+      for (std::size_t i = 0; i < Count; ++i) Output[i] = static_cast<T>(_Slots[i].Signed);
+    } else if (uniform(Category::Unsigned)) {
+      for (std::size_t i = 0; i < Count; ++i) Output[i] = static_cast<T>(_Slots[i].Unsigned);
+    } else if (uniform(Category::Float)) {
+      for (std::size_t i = 0; i < Count; ++i) Output[i] = static_cast<T>(_Slots[i].Float);
+    } else {
+      for (std::size_t i = 0; i < Count; ++i) Output[i] = get(i).cast<T>();
+    }
+  }
+
+  //! Cast all rows to numeric type
+  template <typename T>
+  std::vector<T> cast() const {
+    std::vector<T> Result(size());
+    cast(Result.data());
+    return Result;
+  }
+
+  //! Compare all rows against scalar value
+  bitmask compare(Predicate Op, const dynamic & Scalar) const {
+    switch (Op) {
+      case Predicate::Equal:        return compare<Predicate::Equal>(Scalar);
+      case Predicate::NotEqual:     return compare<Predicate::NotEqual>(Scalar);
+      case Predicate::Less:         return compare<Predicate::Less>(Scalar);
+      case Predicate::LessEqual:    return compare<Predicate::LessEqual>(Scalar);
+      case Predicate::Greater:      return compare<Predicate::Greater>(Scalar);
+      case Predicate::GreaterEqual: return compare<Predicate::GreaterEqual>(Scalar);
+    }
+    throw std::bad_cast();
+  }
+
+  //! Sum of all numeric rows, Undefined rows are skipped, integers are summed in 64 bit
+  dynamic sum() const {
+    const std::size_t Count = size();
+    if (uniform(Category::Signed) || uniform(Category::Unsigned)) {
+      std::uint64_t Result = 0;
+      for (std::size_t i = 0; i < Count; ++i) Result += _Slots[i].Unsigned;
+      if (uniform(Category::Signed)) return static_cast<std::int64_t>(Result);
+      return Result;
+    }
+    if (uniform(Category::Float)) {
+      double Result = 0;
+      for (std::size_t i = 0; i < Count; ++i) Result += _Slots[i].Float;
+      return Result;
+    }
+    if (_Counts[static_cast<std::size_t>(Category::Text)]) throw std::bad_cast();
+
+    // - Mixed column, sum every category separately
+    std::uint64_t Integer = 0;
+    double        Float   = 0;
+    for (std::size_t i = 0; i < Count; ++i) {
+      switch (category(_Kinds[i])) {
+        case Category::Signed:
+        case Category::Unsigned:  Integer += _Slots[i].Unsigned; break;
+        case Category::Float:     Float += _Slots[i].Float; break;
+        default: break;
+      }
+    }
+    if (_Counts[static_cast<std::size_t>(Category::Float)]) {
+      if (_Counts[static_cast<std::size_t>(Category::Signed)]) return Float + static_cast<double>(static_cast<std::int64_t>(Integer));
+      return Float + static_cast<double>(Integer);
+    }
+    if (_Counts[static_cast<std::size_t>(Category::Signed)]) return static_cast<std::int64_t>(Integer);
+    if (_Counts[static_cast<std::size_t>(Category::Unsigned)]) return Integer;
+    return dynamic();
+  }
+
+  //! Minimum of all rows in kind of the row holding it, Undefined rows are skipped
+  dynamic min() const {return extremum<Predicate::Less>();}
+
+  //! Maximum of all rows in kind of the row holding it, Undefined rows are skipped
+  dynamic max() const {return extremum<Predicate::Greater>();}
+
+  //! Select rows with set bits
+  dynamic_array filter(const bitmask & Mask) const {
+    dynamic_array Result;
+    Result.reserve(Mask.count());
+    for (std::size_t i = 0; i < size(); ++i) {
+      if (!Mask.test(i)) continue;
+      Category C = category(_Kinds[i]);
+      slot Slot = _Slots[i];
+      if (C == Category::Text) {
+        Slot.Unsigned = Result._Arena.size();
+        Result._Arena.insert(Result._Arena.end(), _Arena.begin() + _Slots[i].Unsigned, _Arena.begin() + _Slots[i].Unsigned + _Sizes[i]);
+      }
+      Result._Kinds.push_back(_Kinds[i]);
+      Result._Slots.push_back(Slot);
+      Result._Sizes.push_back(_Sizes[i]);
+      ++Result._Counts[static_cast<std::size_t>(C)];
+    }
+    return Result;
+  }
+
+private:
+  //! Widened numeric value or arena offset
+  union slot {
+    std::int64_t  Signed;
+    std::uint64_t Unsigned;
+    double        Float;
+  };
+
+  //! Storage category of row
+  enum class Category : std::uint8_t {Null, Signed, Unsigned, Float, Text, Invalid, Count};
+
+  //! Get storage category of kind
+  static Category category(Kind K) {
+    switch (K) {
+      case Kind::Undefined: return Category::Null;
+      case Kind::Int8: case Kind::Int16: case Kind::Int32: case Kind::Int64:      return Category::Signed;
+      case Kind::UInt8: case Kind::UInt16: case Kind::UInt32: case Kind::UInt64:  return Category::Unsigned;
+      case Kind::Float32: case Kind::Float64: return Category::Float;
+      case Kind::String: case Kind::Binary:   return Category::Text;
+      default: return Category::Invalid;
+    }
+  }
+
+  //! Check are all rows of given category
+  bool uniform(Category C) const {
+    return !empty() && _Counts[static_cast<std::size_t>(C)] == size();
+  }
+
+  //! Get native value of slot
+  template <typename T>
+  static T load(const slot & Slot) {
+    if constexpr (std::is_same<T, std::int64_t>::value)       return Slot.Signed;
+    else if constexpr (std::is_same<T, std::uint64_t>::value) return Slot.Unsigned;
+    else                                                      return Slot.Float;
+  }
+
+  //! Get text value of row
+  std::string_view textAt(std::size_t Index) const {
+    return std::string_view(reinterpret_cast<const char*>(_Arena.data()) + _Slots[Index].Unsigned, _Sizes[Index]);
+  }
+
+  //! Apply predicate on native values
+  template <Predicate P, typename T>
+  static bool test(const T & Value, const T & Scalar) {
+    if constexpr (P == Predicate::Equal)          return Value == Scalar;
+    else if constexpr (P == Predicate::NotEqual)  return !(Value == Scalar);
+    else if constexpr (P == Predicate::Less)      return Value < Scalar;
+    else if constexpr (P == Predicate::LessEqual) return Value <= Scalar;
+    else if constexpr (P == Predicate::Greater)   return Value > Scalar;
+    else                                          return Value >= Scalar;
+  }
+
+  //! Apply predicate on dynamic values, rows not comparable with scalar do not match
+  template <Predicate P>
+  static bool matches(const dynamic & Value, const dynamic & Scalar) {
+    try {
+      if constexpr (P == Predicate::Equal)          return Value == Scalar;
+      else if constexpr (P == Predicate::NotEqual)  return Value != Scalar;
+      else if constexpr (P == Predicate::Less)      return Value < Scalar;
+      else if constexpr (P == Predicate::LessEqual) return Value <= Scalar;
+      else if constexpr (P == Predicate::Greater)   return Value > Scalar;
+      else                                          return Value >= Scalar;
+    } catch (const std::bad_cast &) {
+      return false;
+    }
+  }
+
+  //! Compare native values of slots against scalar
+  template <Predicate P, typename T>
+  static void compareKernel(const slot * Slots, std::size_t Count, T Scalar, bitmask & Result) {
+    std::uint64_t * Words = Result.data();
+    std::size_t     i     = 0;
+  #ifdef __DYNAMIC_ARRAY__WITH_AVX2__
+    // - Four rows per instruction, sixteen per iteration so every iteration fills two bytes of mask
+    for (; i + 16 <= Count; i += 16) {
+      std::uint64_t Bits = 0;
+      for (std::size_t j = 0; j < 16; j += 4) Bits |= static_cast<std::uint64_t>(compare4<P>(Slots + i + j, Scalar)) << j;
+      Words[i / 64] |= Bits << (i % 64);
+    }
+  #endif
+    for (; i < Count; ++i) {
+      Words[i / 64] |= static_cast<std::uint64_t>(test<P>(load<T>(Slots[i]), Scalar)) << (i % 64);
+    }
+  }
+
+#ifdef __DYNAMIC_ARRAY__WITH_AVX2__
+  //! Compare four int64 values against scalar, returns four mask bits
+  template <Predicate P>
+  static int compare4(const slot * Slots, std::int64_t Scalar) {
+    __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Slots));
+    __m256i S = _mm256_set1_epi64x(Scalar);
+    __m256i R;
+    if constexpr (P == Predicate::Equal || P == Predicate::NotEqual)      R = _mm256_cmpeq_epi64(V, S);
+    else if constexpr (P == Predicate::Less || P == Predicate::GreaterEqual) R = _mm256_cmpgt_epi64(S, V);
+    else                                                                  R = _mm256_cmpgt_epi64(V, S);
+    int Mask = _mm256_movemask_pd(_mm256_castsi256_pd(R));
+    if constexpr (P == Predicate::NotEqual || P == Predicate::GreaterEqual || P == Predicate::LessEqual) Mask ^= 0xF;
+    return Mask;
+  }
+
+  //! Compare four double values against scalar, returns four mask bits
+  template <Predicate P>
+  static int compare4(const slot * Slots, double Scalar) {
+    __m256d V = _mm256_loadu_pd(reinterpret_cast<const double*>(Slots));
+    __m256d S = _mm256_set1_pd(Scalar);
+    if constexpr (P == Predicate::Equal)          return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_EQ_OQ));
+    else if constexpr (P == Predicate::NotEqual)  return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_NEQ_UQ));
+    else if constexpr (P == Predicate::Less)      return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_LT_OQ));
+    else if constexpr (P == Predicate::LessEqual) return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_LE_OQ));
+    else if constexpr (P == Predicate::Greater)   return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_GT_OQ));
+    else                                          return _mm256_movemask_pd(_mm256_cmp_pd(V, S, _CMP_GE_OQ));
+  }
+
+  //! Compare four uint64 values against scalar, returns four mask bits
+  template <Predicate P>
+  static int compare4(const slot * Slots, std::uint64_t Scalar) {
+    // - Flip sign bit so signed comparison gives unsigned order
+    const __m256i Bias = _mm256_set1_epi64x(std::numeric_limits<std::int64_t>::min());
+    slot Biased[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(Biased), _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Slots)), Bias));
+    return compare4<P>(Biased, static_cast<std::int64_t>(Scalar ^ (std::uint64_t(1) << 63)));
+  }
+#endif
+
+  //! Compare all rows against scalar value
+  template <Predicate P>
+  bitmask compare(const dynamic & Scalar) const {
+    bitmask     Result(size());
+    Category    S = category(Scalar.kind());
+    if (uniform(Category::Signed) && (S == Category::Signed || (S == Category::Unsigned && Scalar.cast<std::uint64_t>() <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())))) {
+      compareKernel<P>(_Slots.data(), size(), Scalar.cast<std::int64_t>(), Result);
+    } else if (uniform(Category::Unsigned) && S == Category::Unsigned) {
+      compareKernel<P>(_Slots.data(), size(), Scalar.cast<std::uint64_t>(), Result);
+    } else if (uniform(Category::Float) && (S == Category::Float || S == Category::Signed || S == Category::Unsigned)) {
+      compareKernel<P>(_Slots.data(), size(), Scalar.cast<double>(), Result);
+    } else if (uniform(Category::Text) && S == Category::Text) {
+      std::string_view Text = Scalar.as_string_view();
+      for (std::size_t i = 0; i < size(); ++i) Result.set(i, test<P>(textAt(i), Text));
+    } else {
+      for (std::size_t i = 0; i < size(); ++i) Result.set(i, matches<P>(get(i), Scalar));
+    }
+    return Result;
+  }
+
+  //! Find extremum of all rows according to predicate
+  template <Predicate P>
+  dynamic extremum() const {
+    const std::size_t Count = size();
+    if (uniform(Category::Signed))    return get(extremum<P, std::int64_t>());
+    if (uniform(Category::Unsigned))  return get(extremum<P, std::uint64_t>());
+    if (uniform(Category::Float))     return get(extremum<P, double>());
+
+    // - Mixed column, compare by dynamic promotion rules
+    dynamic Result;
+    for (std::size_t i = 0; i < Count; ++i) {
+      if (_Kinds[i] == Kind::Undefined) continue;
+      dynamic Value = get(i);
+      if (Result.type() == dynamic::Type::Undefined || matches<P>(Value, Result)) Result = std::move(Value);
+    }
+    return Result;
+  }
+
+  //! Find row holding extremum of uniform column
+  template <Predicate P, typename T>
+  std::size_t extremum() const {
+    T Result = load<T>(_Slots[0]);
+    for (std::size_t i = 1; i < size(); ++i) {
+      T Value = load<T>(_Slots[i]);
+      Result = test<P>(Value, Result) ? Value : Result;
+    }
+
+    // - Row is matched by bit pattern, so NaN and signed zero find the row the value came from
+    slot Found;
+    std::memcpy(&Found, &Result, sizeof(Found));
+    std::size_t Index = 0;
+    while (_Slots[Index].Unsigned != Found.Unsigned) ++Index;
+    return Index;
+  }
+
+private:
+  //! Kind of every row
+  std::vector<Kind>           _Kinds;
+
+  //! Widened numeric value or arena offset of every row
+  std::vector<slot>           _Slots;
+
+  //! Payload size of String and Binary rows
+  std::vector<std::uint32_t>  _Sizes;
+
+  //! Storage for String and Binary payloads
+  std::vector<std::uint8_t>   _Arena;
+
+  //! Number of rows in every category
+  std::size_t                 _Counts[static_cast<std::size_t>(Category::Count)];
+};
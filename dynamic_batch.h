@@ -0,0 +1,311 @@
+/*
+ * DYNAMIC_BATCH is parallel bulk conversion between dynamic values and typed columns
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "dynamic_array.h"
+
+/**
+ * @brief Bulk conversion of dynamic ranges to native typed buffers and back
+ *
+ * Input is split into tasks of grain values executed by work-stealing pool. Within task stored
+ * type is dispatched once per run of values of the same kind, the run is then converted by tight
+ * loop over native values. Values which can not be converted do not stop the conversion: their
+ * output is value initialized and the bit of their index is set in returned error mask.
+ * Conversions follow cast<T>(): numbers out of range of integer type (NaN included) fail, Strings
+ * are parsed, std::string output gets text of numbers and bytes of String and Binary. Converted
+ * runs are not counted by statistics, only values falling back to try_cast() are.
+ */
+class dynamic_batch {
+public:
+  typedef dynamic::Kind           Kind;
+  typedef dynamic_array::bitmask  bitmask;
+
+  //! Number of values per task, multiple of 64 so tasks never share word of error mask
+  static constexpr std::size_t grain = 4096;
+
+  /**
+   * @brief Fixed size work-stealing thread pool
+   *
+   * Tasks of run() are split to contiguous range per thread, thread takes tasks from the front of
+   * its range and when it is empty steals from the back of ranges of other threads. Ranges are
+   * single atomic words, so taking task never locks. Thread calling run() works as well, nested
+   * run() from inside task and pools of one thread execute tasks inline.
+   */
+  class pool {
+  public:
+    explicit pool(unsigned Threads = std::max(1u, std::thread::hardware_concurrency()))
+      : _Size(std::max(1u, Threads)), _Queues(new queue[_Size]), _Call(nullptr), _Job(nullptr), _Generation(0), _Busy(0), _Stop(false) {
+      _Workers.reserve(_Size - 1);
+      for (unsigned Index = 1; Index < _Size; ++Index) _Workers.emplace_back(&pool::loop, this, Index);
+    }
+
+    ~pool() {
+      {
+        std::lock_guard<std::mutex> Lock(_Mutex);
+        _Stop = true;
+      }
+      _Wake.notify_all();
+      for (std::thread & Worker : _Workers) Worker.join();
+    }
+
+    //! Get number of threads including the calling one
+    unsigned size() const {return _Size;}
+
+    //! Call Function(Task) for every task in [0, Tasks) and wait for all of them, first exception thrown by tasks is rethrown
+    template <typename F>
+    void run(std::size_t Tasks, F && Function) {
+      if (!Tasks) return;
+      if (_Size == 1 || Tasks == 1 || current() == this) {
+        for (std::size_t Task = 0; Task < Tasks; ++Task) Function(Task);
+        return;
+      }
+
+      // - One job at a time, every worker has to finish the job before the next one is published
+      std::lock_guard<std::mutex> Running(_Running);
+      for (unsigned Index = 0; Index < _Size; ++Index) {
+        _Queues[Index].Range.store(range(Tasks * Index / _Size, Tasks * (Index + 1) / _Size), std::memory_order_relaxed);
+      }
+      {
+        std::lock_guard<std::mutex> Lock(_Mutex);
+        _Call = [](const void * Job, std::size_t Task) {(*static_cast<const typename std::remove_reference<F>::type*>(Job))(Task);};
+        _Job  = &Function;
+        _Error = nullptr;
+        _Failed.store(false, std::memory_order_relaxed);
+        _Busy = _Size - 1;
+        ++_Generation;
+      }
+      _Wake.notify_all();
+
+      const pool * Outer = current();
+      current() = this;
+      work(0);
+      current() = Outer;
+
+      std::unique_lock<std::mutex> Lock(_Mutex);
+      _Done.wait(Lock, [this]() {return _Busy == 0;});
+      if (_Error) std::rethrow_exception(_Error);
+    }
+
+    //! Get pool shared by conversions without explicit pool, sized to hardware concurrency
+    static pool & shared() {
+      static pool Shared;
+      return Shared;
+    }
+
+  private:
+    pool(const pool&);
+    pool& operator = (const pool&);
+
+    //! Remaining tasks of one thread, begin in low and end in high half
+    struct alignas(64) queue {
+      std::atomic<std::uint64_t> Range{0};
+    };
+
+    static std::uint64_t range(std::uint64_t Begin, std::uint64_t End) {return Begin | (End << 32);}
+
+    //! Get pool running task on current thread
+    static const pool *& current() {
+      static thread_local const pool * Current = nullptr;
+      return Current;
+    }
+
+    //! Take task from the front of own range
+    static bool pop(queue & Queue, std::size_t & Task) {
+      std::uint64_t Range = Queue.Range.load(std::memory_order_relaxed);
+      for (;;) {
+        std::uint64_t Begin = Range & 0xFFFFFFFFu, End = Range >> 32;
+        if (Begin >= End) return false;
+        if (Queue.Range.compare_exchange_weak(Range, range(Begin + 1, End), std::memory_order_relaxed)) {Task = Begin; return true;}
+      }
+    }
+
+    //! Take task from the back of other thread range
+    static bool steal(queue & Queue, std::size_t & Task) {
+      std::uint64_t Range = Queue.Range.load(std::memory_order_relaxed);
+      for (;;) {
+        std::uint64_t Begin = Range & 0xFFFFFFFFu, End = Range >> 32;
+        if (Begin >= End) return false;
+        if (Queue.Range.compare_exchange_weak(Range, range(Begin, End - 1), std::memory_order_relaxed)) {Task = End - 1; return true;}
+      }
+    }
+
+    //! Execute own tasks, then stolen ones until all ranges are empty
+    void work(unsigned Index) {
+      std::size_t Task;
+      for (;;) {
+        while (pop(_Queues[Index], Task)) execute(Task);
+        bool Stolen = false;
+        for (unsigned Offset = 1; Offset < _Size && !Stolen; ++Offset) Stolen = steal(_Queues[(Index + Offset) % _Size], Task);
+        if (!Stolen) return;
+        execute(Task);
+      }
+    }
+
+    //! Execute task, tasks left after exception are skipped
+    void execute(std::size_t Task) {
+      if (_Failed.load(std::memory_order_relaxed)) return;
+      try {
+        _Call(_Job, Task);
+      } catch (...) {
+        std::lock_guard<std::mutex> Lock(_Mutex);
+        if (!_Error) _Error = std::current_exception();
+        _Failed.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    //! Worker thread
+    void loop(unsigned Index) {
+      current() = this;
+      std::uint64_t Seen = 0;
+      for (;;) {
+        {
+          std::unique_lock<std::mutex> Lock(_Mutex);
+          _Wake.wait(Lock, [this, Seen]() {return _Stop || _Generation != Seen;});
+          if (_Stop) return;
+          Seen = _Generation;
+        }
+        work(Index);
+        std::lock_guard<std::mutex> Lock(_Mutex);
+        if (--_Busy == 0) _Done.notify_one();
+      }
+    }
+
+    const unsigned                _Size;
+    std::unique_ptr<queue[]>      _Queues;
+    std::vector<std::thread>      _Workers;
+
+    //! Current job, type erased function called with task index
+    void                       (* _Call)(const void*, std::size_t);
+    const void                  * _Job;
+
+    std::mutex                    _Running;
+    std::mutex                    _Mutex;
+    std::condition_variable       _Wake;
+    std::condition_variable       _Done;
+    std::uint64_t                 _Generation;
+    unsigned                      _Busy;
+    bool                          _Stop;
+    std::exception_ptr            _Error;
+    std::atomic<bool>             _Failed{false};
+  };
+
+public:
+  //! Convert values to native type, output must have room for Count values, returns mask of values which could not be converted
+  template <typename T>
+  static bitmask cast(const dynamic * Values, std::size_t Count, T * Output, pool & Pool = pool::shared()) {
+    static_assert(std::is_arithmetic<T>::value || std::is_same<T, std::string>::value, "Unsupported type");
+    bitmask Errors(Count);
+    std::uint64_t * Words = Errors.data();
+    Pool.run((Count + grain - 1) / grain, [=](std::size_t Task) {
+      std::size_t First = Task * grain;
+      castRange(Values + First, std::min(grain, Count - First), Output + First, Words + First / 64);
+    });
+    return Errors;
+  }
+
+  //! Convert values to native type, output is resized to number of values, returns mask of values which could not be converted
+  template <typename T>
+  static bitmask cast(const std::vector<dynamic> & Values, std::vector<T> & Output, pool & Pool = pool::shared()) {
+    Output.resize(Values.size());
+    return cast(Values.data(), Values.size(), Output.data(), Pool);
+  }
+
+  //! Assign native values to dynamic values, output must have room for Count values
+  template <typename T>
+  static void assign(const T * Input, std::size_t Count, dynamic * Output, pool & Pool = pool::shared()) {
+    Pool.run((Count + grain - 1) / grain, [=](std::size_t Task) {
+      std::size_t First = Task * grain, Last = std::min(Count, First + grain);
+      for (std::size_t Index = First; Index < Last; ++Index) Output[Index] = Input[Index];
+    });
+  }
+
+  //! Assign native values to dynamic values, output is resized to number of values
+  template <typename T>
+  static void assign(const std::vector<T> & Input, std::vector<dynamic> & Output, pool & Pool = pool::shared()) {
+    Output.resize(Input.size());
+    assign(Input.data(), Input.size(), Output.data(), Pool);
+  }
+
+private:
+  //! Convert values of one task, dispatch is done once per run of the same kind
+  template <typename T>
+  static void castRange(const dynamic * Values, std::size_t Count, T * Output, std::uint64_t * Errors) {
+    typedef dynamic::Type Type;
+    std::size_t Index = 0;
+    while (Index < Count) {
+      switch (Values[Index].kind()) {
+        case Kind::Int8:    Index = castRun<std::int8_t>(Values, Index, Count, Type::SignedInt, Output, Errors); break;
+        case Kind::Int16:   Index = castRun<std::int16_t>(Values, Index, Count, Type::SignedInt, Output, Errors); break;
+        case Kind::Int32:   Index = castRun<std::int32_t>(Values, Index, Count, Type::SignedInt, Output, Errors); break;
+        case Kind::Int64:   Index = castRun<std::int64_t>(Values, Index, Count, Type::SignedInt, Output, Errors); break;
+        case Kind::UInt8:   Index = castRun<std::uint8_t>(Values, Index, Count, Type::UnsignedInt, Output, Errors); break;
+        case Kind::UInt16:  Index = castRun<std::uint16_t>(Values, Index, Count, Type::UnsignedInt, Output, Errors); break;
+        case Kind::UInt32:  Index = castRun<std::uint32_t>(Values, Index, Count, Type::UnsignedInt, Output, Errors); break;
+        case Kind::UInt64:  Index = castRun<std::uint64_t>(Values, Index, Count, Type::UnsignedInt, Output, Errors); break;
+        case Kind::Float32: Index = castRun<float>(Values, Index, Count, Type::Float, Output, Errors); break;
+        case Kind::Float64: Index = castRun<double>(Values, Index, Count, Type::Float, Output, Errors); break;
+        case Kind::String:
+        case Kind::Binary:
+          if constexpr (std::is_same<T, std::string>::value) {
+            // - Bytes are copied as they are, no dispatch needed within the run, UUID is formatted by cast
+            Type Stored = Values[Index].type();
+            if (Stored == Type::String || Stored == Type::Binary) {
+              do {
+                Output[Index].assign(reinterpret_cast<const char*>(Values[Index].data()), Values[Index].size());
+                ++Index;
+              } while (Index < Count && Values[Index].type() == Stored);
+              break;
+            }
+          }
+          [[fallthrough]];
+        default: {
+          // - Parsed Strings, Binary and values without conversion
+          std::optional<T> Result = Values[Index].template try_cast<T>();
+          if (Result) {
+            Output[Index] = std::move(*Result);
+          } else {
+            Output[Index] = T();
+            Errors[Index / 64] |= std::uint64_t(1) << (Index % 64);
+          }
+          ++Index;
+        }
+      }
+    }
+  }
+
+  //! Convert run of numeric values stored as S, returns index past the run
+  template <typename S, typename T>
+  static std::size_t castRun(const dynamic * Values, std::size_t Index, std::size_t Count, dynamic::Type Stored, T * Output, std::uint64_t * Errors) {
+    typedef typename std::conditional<std::is_floating_point<S>::value, double,
+            typename std::conditional<std::is_signed<S>::value, std::int64_t, std::uint64_t>::type>::type Wide;
+    do {
+      S Value = *reinterpret_cast<const S*>(Values[Index].data());
+      if constexpr (std::is_same<T, std::string>::value) {
+        char Buffer[dynamic::max_numeric_length];
+        std::to_chars_result Formatted = std::to_chars(Buffer, Buffer + sizeof(Buffer), Value);
+        Output[Index].assign(Buffer, Formatted.ptr);
+      } else if (!dynamic::narrow<Wide>(Value, Output[Index])) {
+        // - NaN, infinity and values out of range of integer type
+        Output[Index] = T();
+        Errors[Index / 64] |= std::uint64_t(1) << (Index % 64);
+      }
+      ++Index;
+    } while (Index < Count && Values[Index].type() == Stored && Values[Index].size() == sizeof(S));
+    return Index;
+  }
+};
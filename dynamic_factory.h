@@ -1,12 +1,42 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
 #include <mutex>
-#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "hazard_domain.h"
+#include "object_pool.h"
 
 /**
  * @class DynamicFactory
  * @author Andrey Bezborodov
  * @brief Dynamic class factory. Create instance of class by it's string name.
+ *
+ * Registered classes are kept in immutable snapshot published through atomic pointer, lookups
+ * take no lock. Registration copies the snapshot under writer mutex and retires the old one.
+ * Lookup copies class data out of the snapshot and releases it before constructor of the class
+ * runs, so constructors may use the factory; lookup nested in more hazard guards than a thread
+ * has slots reads the snapshot under writer mutex instead.
+ * Every registered class gets an object pool on its first CreatePooledInstance(). The pool is
+ * retired together with the class, when the last snapshot holding it is reclaimed, and deleted
+ * once its last pooled instance is released, so pooled instances may outlive both the class
+ * registration and the factory.
+ * Class registered with constructor arguments is created only by passing arguments of the same types
+ * (after decay) to CreateInstance(), CreatePooledInstance() or CreateInstances(), never by their
+ * overloads without arguments.
+ * Classes known at build time can be given to constructor as StaticRegistry: table with perfect
+ * hash of class names generated at compile time. Such classes are looked up before the runtime
+ * registered ones without touching the snapshot, they are never allocated and can not be unregistered.
  */
 template <class Base>
 class dynamic_factory {
@@ -22,119 +52,918 @@ public:
   class abstract_instantiator {
   public:
     //! Constructor
-    abstract_instantiator() {}
+    constexpr abstract_instantiator() {}
 
     //! Destructor
     virtual ~abstract_instantiator() {}
 
     //! Create instance of concrete subclass of Base
     virtual BaseType* CreateInstance() const = 0;
+
+    //! Create instance of concrete subclass of Base in given memory
+    virtual BaseType* CreateInstance(void* memory) const = 0;
   private:
     abstract_instantiator(const abstract_instantiator&);
     abstract_instantiator& operator = (const abstract_instantiator&);
   };
 
+  /**
+   * @brief Instantiator interface for constructor with given arguments
+   */
+  template <class BaseType, class... Args>
+  class arguments_instantiator {
+  public:
+    //! Destructor
+    virtual ~arguments_instantiator() {}
+
+    //! Create instance passing arguments to constructor
+    virtual BaseType* Construct(Args... args) const = 0;
+
+    //! Create instance passing arguments to constructor in given memory
+    virtual BaseType* ConstructAt(void* memory, Args... args) const = 0;
+
+    //! Create given number of instances in contiguous memory, every instance gets copy of arguments
+    virtual void ConstructArray(void* memory, std::size_t count, const Args&... args) const = 0;
+  };
+
   //! Instantiator class
-  template <class C, class BaseType>
-  class instantiator : public abstract_instantiator<BaseType> {
+  template <class C, class BaseType, class... Args>
+  class instantiator : public abstract_instantiator<BaseType>, public arguments_instantiator<BaseType, Args...> {
   public:
     //! Constructor
-    instantiator() {}
+    constexpr instantiator() {}
 
     //! Destructor
     virtual ~instantiator() {}
 
-    //! Create instance
+    //! Create instance, null if class is not default constructible
     BaseType* CreateInstance() const override {
-      return new C;
+      if constexpr (std::is_default_constructible<C>::value) return new C;
+      else return nullptr;
+    }
+
+    //! Create instance in given memory, null if class is not default constructible
+    BaseType* CreateInstance(void* memory) const override {
+      if constexpr (std::is_default_constructible<C>::value) return new (memory) C;
+      else return nullptr;
+    }
+
+    //! Create instance with constructor arguments
+    BaseType* Construct(Args... args) const override {
+      return new C(std::move(args)...);
+    }
+
+    //! Create instance with constructor arguments in given memory
+    BaseType* ConstructAt(void* memory, Args... args) const override {
+      return new (memory) C(std::move(args)...);
+    }
+
+    //! Create array of instances, constructed instances are destroyed if constructor throws
+    void ConstructArray(void* memory, std::size_t count, const Args&... args) const override {
+      std::size_t index = 0;
+      try {
+        for (; index < count; ++index) new (static_cast<C*>(memory) + index) C(args...);
+      } catch (...) {
+        DestroyArray(memory, index);
+        throw;
+      }
+    }
+
+    //! Destroy instance created in pool memory, returns the memory
+    static void* DestroyInstance(BaseType* instance) {
+      C* object = static_cast<C*>(instance);
+      object->~C();
+      return object;
+    }
+
+    //! Destroy array of instances in reverse order
+    static void DestroyArray(void* memory, std::size_t count) {
+      while (count--) (static_cast<C*>(memory) + count)->~C();
+    }
+
+    //! Get base of instance stored in given memory
+    static BaseType* Cast(void* memory) {
+      return static_cast<C*>(memory);
     }
   };
 
 public:
   typedef abstract_instantiator<Base>  AbstractFactory;
 
+  /**
+   * @brief Handle of registered class returned by Resolve()
+   *
+   * Handle stays valid until the class is unregistered, CreateInstance() with stale or empty
+   * handle returns null.
+   */
+  class ClassHandle {
+  public:
+    //! Create empty handle
+    ClassHandle() : index_(invalid), generation_(0) {}
+
+    //! Check is handle resolved
+    bool IsValid() const {return index_ != invalid;}
+    explicit operator bool() const {return IsValid();}
+
+  private:
+    friend class dynamic_factory;
+    static constexpr std::uint32_t invalid = ~std::uint32_t(0);
+
+    //! Index bit of classes from static registry
+    static constexpr std::uint32_t static_flag = std::uint32_t(1) << 31;
+
+    ClassHandle(std::uint32_t index, std::uint32_t generation) : index_(index), generation_(generation) {}
+
+    std::uint32_t index_;
+    std::uint32_t generation_;
+  };
+
+  /**
+   * @brief Deleter returning pooled instance to pool of its class
+   */
+  class InstanceDeleter {
+  public:
+    InstanceDeleter() : pool_(nullptr), destroy_(nullptr) {}
+
+    void operator () (Base* instance) const {
+      pool_->deallocate(destroy_(instance));
+    }
+
+  private:
+    friend class dynamic_factory;
+    InstanceDeleter(object_pool* pool, void* (*destroy)(Base*)) : pool_(pool), destroy_(destroy) {}
+
+    object_pool*  pool_;
+    void*         (*destroy_)(Base*);
+  };
+
+  //! Owning pointer to pooled instance
+  typedef std::unique_ptr<Base, InstanceDeleter> InstancePtr;
+
+  /**
+   * @brief Instances created by CreateInstances() in single contiguous allocation
+   */
+  class InstanceArray {
+  public:
+    //! Iterator over instances
+    class iterator {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef Base                      value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef Base*                     pointer;
+      typedef Base&                     reference;
+
+      iterator() : position_(nullptr), stride_(0) {}
+
+      Base& operator * () const   {return *reinterpret_cast<Base*>(position_);}
+      Base* operator -> () const  {return reinterpret_cast<Base*>(position_);}
+
+      iterator& operator ++ ()    {position_ += stride_; return *this;}
+      iterator operator ++ (int)  {iterator result = *this; position_ += stride_; return result;}
+
+      bool operator == (const iterator& other) const {return position_ == other.position_;}
+      bool operator != (const iterator& other) const {return position_ != other.position_;}
+
+    private:
+      friend class InstanceArray;
+      iterator(std::uint8_t* position, std::size_t stride) : position_(position), stride_(stride) {}
+
+      std::uint8_t* position_;
+      std::size_t   stride_;
+    };
+
+    InstanceArray() : memory_(nullptr), count_(0), stride_(0), offset_(0), alignment_(0), destroy_(nullptr) {}
+    InstanceArray(InstanceArray&& other) noexcept : InstanceArray() {Swap(other);}
+    ~InstanceArray() {Release();}
+
+    InstanceArray& operator = (InstanceArray&& other) noexcept {
+      InstanceArray released(std::move(other));
+      Swap(released);
+      return *this;
+    }
+
+    std::size_t size() const  {return count_;}
+    bool empty() const        {return !count_;}
+
+    Base& operator [] (std::size_t index) const {
+      return *reinterpret_cast<Base*>(memory_ + offset_ + index * stride_);
+    }
+
+    iterator begin() const  {return iterator(memory_ + offset_, stride_);}
+    iterator end() const    {return iterator(memory_ + offset_ + count_ * stride_, stride_);}
+
+  private:
+    friend class dynamic_factory;
+    InstanceArray(const InstanceArray&);
+    InstanceArray& operator = (const InstanceArray&);
+
+    void Swap(InstanceArray& other) {
+      std::swap(memory_, other.memory_);
+      std::swap(count_, other.count_);
+      std::swap(stride_, other.stride_);
+      std::swap(offset_, other.offset_);
+      std::swap(alignment_, other.alignment_);
+      std::swap(destroy_, other.destroy_);
+    }
+
+    void Release() {
+      if (!memory_) return;
+      destroy_(memory_, count_);
+      ::operator delete(memory_, std::align_val_t(alignment_));
+      memory_ = nullptr;
+      count_  = 0;
+    }
+
+    std::uint8_t*   memory_;
+    std::size_t     count_;
+    std::size_t     stride_;
+    std::size_t     offset_;
+    std::size_t     alignment_;
+    void            (*destroy_)(void*, std::size_t);
+  };
+
+  //! Statistics of class pool
+  typedef object_pool::statistics PoolStats;
+
+  /**
+   * @brief Description of class: name, instantiator and layout
+   *
+   * Made by StaticClass() as constant expression, instantiators are static objects shared by all
+   * factories of Base.
+   */
+  struct ClassInfo {
+    std::string_view        name;
+    const AbstractFactory*  factory = nullptr;
+
+    //! Constructor argument types and instantiator interface for them
+    const void*             signature = nullptr;
+    const void*             arguments = nullptr;
+
+    //! Layout of class
+    std::size_t             size = 0;
+    std::size_t             alignment = 0;
+    void*                   (*destroy)(Base*) = nullptr;
+    void                    (*destroyArray)(void*, std::size_t) = nullptr;
+    Base*                   (*cast)(void*) = nullptr;
+  };
+
+  //! Describe class of specified type with given name, optionally with types of constructor arguments
+  template <class ClassType, class... Args>
+  static constexpr ClassInfo StaticClass(std::string_view class_name) {
+    typedef instantiator<ClassType, Base, typename std::decay<Args>::type...> Instantiator;
+    const Instantiator& factory = StaticInstance<Instantiator>::instance;
+
+    // - Bases are taken by reference, pointer conversion would need null check of weak symbol
+    return ClassInfo{
+      class_name, &static_cast<const AbstractFactory&>(factory),
+      Signature<typename std::decay<Args>::type...>::Id(),
+      &static_cast<const arguments_instantiator<Base, typename std::decay<Args>::type...>&>(factory),
+      sizeof(ClassType), alignof(ClassType),
+      &Instantiator::DestroyInstance, &Instantiator::DestroyArray, &Instantiator::Cast
+    };
+  }
+
+private:
+  //! Slot of static registry, index equal to number of classes marks empty slot
+  struct StaticSlot {
+    std::uint64_t hash = 0;
+    std::uint32_t index = 0;
+  };
+
+  //! Instantiator shared by all classes described with the same type and arguments
+  template <class Instantiator>
+  struct StaticInstance {
+    static inline const Instantiator instance{};
+  };
+
+  //! Get the smallest power of two not less than count
+  static constexpr std::size_t Capacity(std::size_t count) {
+    std::size_t result = 1;
+    while (result < count) result <<= 1;
+    return result;
+  }
+
+  //! Hash class name eight bytes at a time, the last word overlaps the previous one
+  static constexpr std::uint64_t Hash(std::string_view class_name) {
+    const char*       data   = class_name.data();
+    const std::size_t size   = class_name.size();
+    std::uint64_t     result = 0x9E3779B97F4A7C15ull ^ size;
+    if (size >= 8) {
+      for (std::size_t index = 0; index + 8 < size; index += 8) result = Round(result, Load(data + index, 8));
+      result = Round(result, Load(data + size - 8, 8));
+    } else if (size >= 4) {
+      result = Round(result, Load(data, 4) | Load(data + size - 4, 4) << 32);
+    } else if (size) {
+      result = Round(result, Load(data, 1) | Load(data + size / 2, 1) << 8 | Load(data + size - 1, 1) << 16);
+    }
+    return result;
+  }
+
+  //! Compare names by words the same way as they are hashed
+  static constexpr bool Equal(std::string_view first, std::string_view second) {
+    const std::size_t size = first.size();
+    if (size != second.size()) return false;
+    if (size < 4) return first == second;
+    if (size < 8) {
+      return !((Load(first.data(), 4) ^ Load(second.data(), 4)) | (Load(first.data() + size - 4, 4) ^ Load(second.data() + size - 4, 4)));
+    }
+    std::uint64_t difference = Load(first.data() + size - 8, 8) ^ Load(second.data() + size - 8, 8);
+    for (std::size_t index = 0; index + 8 < size; index += 8) difference |= Load(first.data() + index, 8) ^ Load(second.data() + index, 8);
+    return !difference;
+  }
+
+  //! Combine word into hash
+  static constexpr std::uint64_t Round(std::uint64_t result, std::uint64_t word) {
+    result = (result ^ word) * 0xFF51AFD7ED558CCDull;
+    return result ^ (result >> 32);
+  }
+
+  //! Load little endian word, bytewise in constant expression, by one load at runtime
+  static constexpr std::uint64_t Load(const char* data, std::size_t size) {
+    std::uint64_t result = 0;
+  #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (!__builtin_is_constant_evaluated()) {
+      std::memcpy(&result, data, size);
+      return result;
+    }
+  #endif
+    for (std::size_t byte = 0; byte < size; ++byte) result |= std::uint64_t(static_cast<unsigned char>(data[byte])) << (8 * byte);
+    return result;
+  }
+
+  //! Mix bits of hash so low bits depend on all of them
+  static constexpr std::uint64_t Mix(std::uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+  }
+
+  //! Get slot of name in bucket with given seed
+  static constexpr std::uint64_t Displace(std::uint64_t hash, std::int32_t seed, std::uint64_t mask) {
+    return Mix(hash + static_cast<std::uint64_t>(seed) * 0x9E3779B97F4A7C15ull) & mask;
+  }
+
+  //! Find class by name in static table
+  static constexpr const ClassInfo* Lookup(std::string_view class_name, const ClassInfo* classes, std::size_t count,
+                                           const StaticSlot* slots, const std::int32_t* displacement, std::uint64_t mask) {
+    const std::uint64_t hash = Hash(class_name);
+    const std::int32_t  seed = displacement[Mix(hash) & mask];
+    const StaticSlot&   slot = slots[seed < 0 ? static_cast<std::uint64_t>(-std::int64_t(seed) - 1) : Displace(hash, seed, mask)];
+    return slot.hash == hash && slot.index < count && Equal(classes[slot.index].name, class_name) ? &classes[slot.index] : nullptr;
+  }
+
+public:
+  /**
+   * @brief Classes known at build time with perfect hash of their names
+   *
+   * Built as constant expression by MakeStaticRegistry(), duplicate names fail the compilation.
+   * Names are hashed once, the hash selects bucket, bucket stores either the slot of its only name
+   * or seed of second hash placing all its names into distinct slots (hash and displace). Lookup
+   * is one pass over the name, two table reads and one comparison.
+   */
+  template <std::size_t N>
+  class StaticRegistry {
+  public:
+    static_assert(N > 0, "Static registry needs at least one class");
+
+    //! Number of slots, power of two
+    static constexpr std::size_t capacity = Capacity(N);
+
+    template <class... Classes>
+    constexpr explicit StaticRegistry(const Classes&... classes) : classes_{classes...} {
+      // - Hash names and group them by bucket
+      std::uint64_t hashes[N] = {};
+      std::size_t   offsets[capacity + 1] = {};
+      std::size_t   order[N] = {};
+      std::size_t   largest = 0;
+      for (std::size_t index = 0; index < N; ++index) {
+        hashes[index] = Hash(classes_[index].name);
+        ++offsets[Mix(hashes[index]) & (capacity - 1)];
+      }
+      for (std::size_t bucket = 0, total = 0; bucket <= capacity; ++bucket) {
+        std::size_t count = offsets[bucket];
+        largest = count > largest ? count : largest;
+        offsets[bucket] = total;
+        total += count;
+      }
+      std::size_t fill[capacity] = {};
+      for (std::size_t index = 0; index < N; ++index) {
+        std::size_t bucket = Mix(hashes[index]) & (capacity - 1);
+        order[offsets[bucket] + fill[bucket]++] = index;
+      }
+      for (std::size_t slot = 0; slot < capacity; ++slot) slots_[slot] = StaticSlot{0, static_cast<std::uint32_t>(N)};
+
+      // - Place the largest buckets first while most slots are free, single names take what is left
+      std::size_t next_free = 0;
+      for (std::size_t size = largest; size > 0; --size) {
+        for (std::size_t bucket = 0; bucket < capacity; ++bucket) {
+          const std::size_t first = offsets[bucket];
+          if (offsets[bucket + 1] - first != size) continue;
+          if (size == 1) {
+            while (slots_[next_free].index != N) ++next_free;
+            Place(next_free, hashes[order[first]], order[first]);
+            displacement_[bucket] = -static_cast<std::int32_t>(next_free) - 1;
+            continue;
+          }
+          for (std::size_t i = first; i < first + size; ++i) {
+            for (std::size_t j = first; j < i; ++j) {
+              if (hashes[order[i]] == hashes[order[j]]) throw std::logic_error("Duplicate class name in static registry");
+            }
+          }
+          for (std::int32_t seed = 1;; ++seed) {
+            if (seed == max_seed) throw std::logic_error("Unable to build perfect hash of class names");
+            bool placed = true;
+            for (std::size_t i = first; i < first + size && placed; ++i) {
+              std::uint64_t slot = Displace(hashes[order[i]], seed, capacity - 1);
+              placed = slots_[slot].index == N;
+              for (std::size_t j = first; j < i && placed; ++j) placed = slot != Displace(hashes[order[j]], seed, capacity - 1);
+            }
+            if (!placed) continue;
+            for (std::size_t i = first; i < first + size; ++i) Place(Displace(hashes[order[i]], seed, capacity - 1), hashes[order[i]], order[i]);
+            displacement_[bucket] = seed;
+            break;
+          }
+        }
+      }
+    }
+
+    //! Get number of classes
+    static constexpr std::size_t size() {return N;}
+
+    //! Find class by name, null if not present
+    constexpr const ClassInfo* Find(std::string_view class_name) const {
+      return Lookup(class_name, classes_, N, slots_, displacement_, capacity - 1);
+    }
+
+  private:
+    friend class dynamic_factory;
+
+    //! Store class in slot
+    constexpr void Place(std::size_t slot, std::uint64_t hash, std::size_t index) {
+      slots_[slot] = StaticSlot{hash, static_cast<std::uint32_t>(index)};
+    }
+
+    static constexpr std::int32_t max_seed = 1 << 20;
+
+    ClassInfo     classes_[N];
+    StaticSlot    slots_[capacity] = {};
+    std::int32_t  displacement_[capacity] = {};
+  };
+
+  //! Build static registry of classes described by StaticClass()
+  template <class... Classes>
+  static constexpr StaticRegistry<sizeof...(Classes)> MakeStaticRegistry(const Classes&... classes) {
+    return StaticRegistry<sizeof...(Classes)>(classes...);
+  }
+
   //! Constructor
-  dynamic_factory() {}
+  dynamic_factory() : registry_(nullptr), static_pools_(nullptr) {}
+
+  //! Constructor with classes known at build time, registry must outlive the factory
+  template <std::size_t N>
+  explicit dynamic_factory(const StaticRegistry<N>& classes) : dynamic_factory() {
+    static_ = StaticTable{classes.classes_, classes.slots_, classes.displacement_, StaticRegistry<N>::capacity - 1, N};
+  }
+
+  //! Temporary registry would be gone before the factory, keep it in static storage
+  template <std::size_t N>
+  explicit dynamic_factory(const StaticRegistry<N>&&) = delete;
 
   //! Destructor
   ~dynamic_factory() {
-    // - Remove instantiators
-    for (typename FactoryMap::iterator it = map_.begin(); it != map_.end(); ++it) {
-      delete it->second;
+    delete registry_.load(std::memory_order_relaxed);
+    if (std::atomic<object_pool*>* pools = static_pools_.load(std::memory_order_relaxed)) {
+      for (std::size_t index = 0; index < static_.count; ++index) {
+        if (object_pool* pool = pools[index].load(std::memory_order_relaxed)) pool->retire();
+      }
+      delete[] pools;
     }
   }
 
-  //! Create a new instance of the class with given name
-  Base* CreateInstance(const std::string& class_name) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+  //! Create a new instance of the class with given name, returns null if class is registered with constructor arguments
+  Base* CreateInstance(std::string_view class_name) const {
     // - Find class by name and create instance if exists, return null otherwise
-    typename FactoryMap::const_iterator it = map_.find(class_name);
-    if (it == map_.end()) return nullptr;
-    else return it->second->CreateInstance();
+    Found found;
+    if (!Find(class_name, Signature<>::Id(), false, found)) return nullptr;
+    else return found.factory->CreateInstance();
+  }
+
+  //! Create a new instance of resolved class, returns null if class was unregistered
+  Base* CreateInstance(ClassHandle handle) const {
+    Found found;
+    return Find(handle, Signature<>::Id(), false, found) ? found.factory->CreateInstance() : nullptr;
+  }
+
+  //! Create a new instance passing arguments to constructor, returns null if class is not registered with such arguments
+  template <class... Args>
+  Base* CreateInstance(std::string_view class_name, Args&&... args) const {
+    return Construct(class_name, std::forward<Args>(args)...);
+  }
+
+  //! Create a new instance of resolved class passing arguments to constructor
+  template <class... Args>
+  Base* CreateInstance(ClassHandle handle, Args&&... args) const {
+    return Construct(handle, std::forward<Args>(args)...);
+  }
+
+  //! Create a new instance of the class with given name in pool of the class, returns null if class is not registered
+  InstancePtr CreatePooledInstance(std::string_view class_name) const {
+    Found found;
+    if (!Find(class_name, Signature<>::Id(), true, found)) return InstancePtr();
+    return CreatePooledInstance(found, [&found](void* memory) {return found.factory->CreateInstance(memory);});
+  }
+
+  //! Create a new instance of resolved class in pool of the class, returns null if class was unregistered
+  InstancePtr CreatePooledInstance(ClassHandle handle) const {
+    Found found;
+    if (!Find(handle, Signature<>::Id(), true, found)) return InstancePtr();
+    return CreatePooledInstance(found, [&found](void* memory) {return found.factory->CreateInstance(memory);});
+  }
+
+  //! Create a new pooled instance passing arguments to constructor
+  template <class... Args>
+  InstancePtr CreatePooledInstance(std::string_view class_name, Args&&... args) const {
+    return ConstructPooled(class_name, std::forward<Args>(args)...);
+  }
+
+  //! Create a new pooled instance of resolved class passing arguments to constructor
+  template <class... Args>
+  InstancePtr CreatePooledInstance(ClassHandle handle, Args&&... args) const {
+    return ConstructPooled(handle, std::forward<Args>(args)...);
   }
 
-  //! Register class of specified type
-  template <class ClassType>
-  bool RegisterClass(const std::string& class_name) {
-    return RegisterClass(class_name, new instantiator<ClassType, Base>);
+  //! Create given number of instances in one contiguous allocation, every instance gets copy of arguments
+  template <class... Args>
+  InstanceArray CreateInstances(std::string_view class_name, std::size_t count, const Args&... args) const {
+    return ConstructArray(class_name, count, args...);
   }
 
-  //! Unregister class
-  bool UnregisterClass(const std::string& class_name) {
+  //! Create given number of instances of resolved class in one contiguous allocation
+  template <class... Args>
+  InstanceArray CreateInstances(ClassHandle handle, std::size_t count, const Args&... args) const {
+    return ConstructArray(handle, count, args...);
+  }
+
+  //! Get statistics of pool of the class with given name, empty statistics if class is not registered
+  PoolStats GetPoolStats(std::string_view class_name) const {
+    hazard_domain::guard guard;
+    std::unique_lock<std::mutex> lock = Fallback(guard);
+    const ClassInfo* entry = Find(guard, class_name);
+    object_pool* pool = entry ? Pool(*entry, false) : nullptr;
+    return pool ? pool->stats() : PoolStats();
+  }
+
+  //! Resolve class name to handle, returns empty handle if class is not registered
+  ClassHandle Resolve(std::string_view class_name) const {
+    if (const ClassInfo* info = static_.Find(class_name)) {
+      return ClassHandle(ClassHandle::static_flag | static_cast<std::uint32_t>(info - static_.classes), 0);
+    }
+    hazard_domain::guard guard;
+    std::unique_lock<std::mutex> lock = Fallback(guard);
+    const Registry* registry = Acquire(guard);
+    if (!registry) return ClassHandle();
+
+    typename FactoryMap::const_iterator it = registry->map.find(class_name);
+    if (it == registry->map.end()) return ClassHandle();
+    return ClassHandle(it->second, registry->slots[it->second].generation);
+  }
+
+  //! Register class of specified type, optionally with types of constructor arguments
+  template <class ClassType, class... Args>
+  bool RegisterClass(std::string_view class_name) {
+    // - Instantiator is shared static object, entry owns copy of the name
+    std::shared_ptr<Entry> entry(new Entry{StaticClass<ClassType, Args...>(class_name), std::string(class_name)});
+    entry->name = entry->owned_name;
+    return RegisterClass(class_name, entry);
+  }
+
+  //! Unregister class, classes from static registry can not be unregistered
+  bool UnregisterClass(std::string_view class_name) {
     std::lock_guard<std::mutex> lock(mutex_);
+    const Registry* current = registry_.load(std::memory_order_relaxed);
+    if (!current) return false;
 
     // - Find class by name
-    typename FactoryMap::iterator it = map_.find(class_name);
-    if (it == map_.end()) return false;
+    typename FactoryMap::const_iterator it = current->map.find(class_name);
+    if (it == current->map.end()) return false;
 
-    // - Delete class instantiator
-    delete it->second;
-    map_.erase(it);
+    // - Publish snapshot without class, instantiator is deleted with the last snapshot using it
+    std::unique_ptr<Registry> next(new Registry(*current));
+    next->Remove(it->second);
+    Publish(next.release());
     return true;
   }
 
-  //! Unregister all classes
+  //! Unregister all classes except the ones from static registry
   void UnregisterAll() {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (typename FactoryMap::iterator it = map_.begin(); it != map_.end(); ++it) {
-      delete it->second;
+    const Registry* current = registry_.load(std::memory_order_relaxed);
+    if (!current) return;
+
+    // - Keep slots to invalidate outstanding handles
+    std::unique_ptr<Registry> next(new Registry(*current));
+    for (std::uint32_t index = 0; index < next->slots.size(); ++index) {
+      if (next->slots[index].entry) next->Remove(index);
     }
-    map_.clear();
+    Publish(next.release());
   }
 
   //! Check is class registered
-  bool HasClass(const std::string& class_name) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return (map_.find(class_name) != map_.end());
+  bool HasClass(std::string_view class_name) const {
+    if (static_.Find(class_name)) return true;
+    hazard_domain::guard guard;
+    std::unique_lock<std::mutex> lock = Fallback(guard);
+    return Find(Acquire(guard), class_name) != nullptr;
   }
 
 private:
 	dynamic_factory(const dynamic_factory&);
 	dynamic_factory& operator = (const dynamic_factory&);
 
+  //! Unique tag of constructor argument types
+  template <class... Args>
+  struct Signature {
+    static constexpr char id = 0;
+    static constexpr const void* Id() {return &id;}
+  };
+
+  //! Class registered at runtime, name is owned here and referenced by map keys
+  struct Entry : ClassInfo {
+    //! Pool is retired with the class, it lives on while pooled instances do
+    ~Entry() {
+      if (object_pool* created = pool.load(std::memory_order_acquire)) created->retire();
+    }
+
+    std::string                       owned_name;
+
+    //! Pool of the class, created on first pooled instance
+    mutable std::atomic<object_pool*> pool{nullptr};
+  };
+
+  //! Class copied out of registry snapshot, valid after the snapshot is released except the name
+  struct Found : ClassInfo {
+    //! Pool of the class and instance memory taken from it, when requested
+    object_pool*  pool = nullptr;
+    void*         memory = nullptr;
+  };
+
+  //! View of static registry given to constructor
+  struct StaticTable {
+    const ClassInfo*    classes = nullptr;
+    const StaticSlot*   slots = nullptr;
+    const std::int32_t* displacement = nullptr;
+    std::uint64_t       mask = 0;
+    std::size_t         count = 0;
+
+    //! Find class by name, null if not present
+    const ClassInfo* Find(std::string_view class_name) const {
+      return count ? Lookup(class_name, classes, count, slots, displacement, mask) : nullptr;
+    }
+
+    //! Get class by index, null if out of range
+    const ClassInfo* At(std::uint32_t index) const {
+      return index < count ? &classes[index] : nullptr;
+    }
+
+    //! Check is class from this table
+    bool Contains(const ClassInfo* info) const {
+      return count && !std::less<const ClassInfo*>()(info, classes) && std::less<const ClassInfo*>()(info, classes + count);
+    }
+  };
+
+  //! Class slot addressed by handle
+  struct Slot {
+    std::shared_ptr<const Entry>  entry;
+    std::uint32_t                 generation = 0;
+  };
+
+  //! Factory map type: class name to slot index
+  typedef std::unordered_map<std::string_view, std::uint32_t> FactoryMap;
+
+  //! Immutable snapshot of registered classes
+  struct Registry : public hazard_domain::node {
+    FactoryMap                  map;
+    std::vector<Slot>           slots;
+    std::vector<std::uint32_t>  free;
+
+    //! Remove class in given slot, handles to it become stale
+    void Remove(std::uint32_t index) {
+      map.erase(std::string_view(slots[index].entry->name));
+      slots[index].entry.reset();
+      ++slots[index].generation;
+      free.push_back(index);
+    }
+  };
+
   //! Register class of specified type (impementation)
-  bool RegisterClass(const std::string& class_name, AbstractFactory* factory_ptr) {
+  bool RegisterClass(std::string_view class_name, const std::shared_ptr<Entry>& entry) {
     std::lock_guard<std::mutex> lock(mutex_);
-
-    // - Take ownership on instantiator
-    std::auto_ptr<AbstractFactory> ptr(factory_ptr);
+    const Registry* current = registry_.load(std::memory_order_relaxed);
 
     // - Check is class name already registered
-    typename FactoryMap::iterator it = map_.find(class_name);
-    if (it != map_.end()) return false;
+    if (static_.Find(class_name)) return false;
+    if (current && current->map.find(class_name) != current->map.end()) return false;
 
-    // - Register class
-    map_[class_name] = ptr.release();
+    // - Publish snapshot with class registered, free slots are reused
+    std::unique_ptr<Registry> next(current ? new Registry(*current) : new Registry);
+    std::uint32_t index;
+    if (next->free.empty()) {
+      index = static_cast<std::uint32_t>(next->slots.size());
+      next->slots.push_back(Slot());
+    } else {
+      index = next->free.back();
+      next->free.pop_back();
+    }
+    next->slots[index].entry = entry;
+    next->map.emplace(std::string_view(entry->name), index);
+    Publish(next.release());
     return true;
   }
 
-  //! Factory map type
-  typedef std::map<std::string, AbstractFactory*> FactoryMap;
+  //! Get instantiator interface of class registered with given argument types, null if registered with other types
+  template <class... Args>
+  static const arguments_instantiator<Base, Args...>* Arguments(const ClassInfo* entry) {
+    if (!entry || entry->signature != Signature<Args...>::Id()) return nullptr;
+    return static_cast<const arguments_instantiator<Base, Args...>*>(entry->arguments);
+  }
+
+  //! Find registered class by name in given snapshot
+  static const ClassInfo* Find(const Registry* registry, std::string_view class_name) {
+    if (!registry) return nullptr;
+    typename FactoryMap::const_iterator it = registry->map.find(class_name);
+    return it == registry->map.end() ? nullptr : registry->slots[it->second].entry.get();
+  }
+
+  //! Find resolved class in given snapshot, null if class was unregistered
+  static const ClassInfo* Find(const Registry* registry, ClassHandle handle) {
+    if (!registry || handle.index_ >= registry->slots.size()) return nullptr;
+    const Slot& slot = registry->slots[handle.index_];
+    return slot.generation == handle.generation_ ? slot.entry.get() : nullptr;
+  }
 
-  //! Map of registered classes
-  FactoryMap          map_;
+  //! Copy class found by key, registered with given argument signature, false if not found
+  template <class Key>
+  bool Find(Key key, const void* signature, bool pooled, Found& found) const {
+    hazard_domain::guard guard;
+    if (guard.reserved()) return FindLocked(guard, key, signature, pooled, found);
+    return Copy(Find(guard, key), signature, pooled, found);
+  }
+
+  //! Copy class found by key under writer mutex, used when guard is reserved
+  template <class Key>
+  bool FindLocked(hazard_domain::guard& guard, Key key, const void* signature, bool pooled, Found& found) const {
+    std::unique_lock<std::mutex> lock = Fallback(guard);
+    return Copy(Find(guard, key), signature, pooled, found);
+  }
+
+  //! Copy class out of protected snapshot, instance memory is taken from its pool when requested
+  bool Copy(const ClassInfo* info, const void* signature, bool pooled, Found& found) const {
+    if (!info || info->signature != signature) return false;
+
+    // - Instantiators are static objects, only the class data is copied, snapshot is released before user code runs
+    static_cast<ClassInfo&>(found) = *info;
+    found.name = std::string_view();
+    if (pooled) {
+      found.pool = Pool(*info);
+      found.memory = found.pool->allocate();
+    }
+    return true;
+  }
+
+  //! Lock writer mutex instead of publishing hazard when guard is nested beyond own slot
+  std::unique_lock<std::mutex> Fallback(const hazard_domain::guard& guard) const {
+    // - Reserved slot is shared by nested guards, destructor of inner one would drop protection of outer one
+    return guard.reserved() ? std::unique_lock<std::mutex>(mutex_) : std::unique_lock<std::mutex>();
+  }
+
+  //! Find class by name, static classes first
+  const ClassInfo* Find(hazard_domain::guard& guard, std::string_view class_name) const {
+    const ClassInfo* info = static_.Find(class_name);
+    return info ? info : Find(Acquire(guard), class_name);
+  }
+
+  //! Find resolved class, static classes first, null if class was unregistered
+  const ClassInfo* Find(hazard_domain::guard& guard, ClassHandle handle) const {
+    if (handle.IsValid() && (handle.index_ & ClassHandle::static_flag)) return static_.At(handle.index_ & ~ClassHandle::static_flag);
+    return Find(Acquire(guard), handle);
+  }
 
-  //! Mutex for prevent concurent access ot map in MT environment
+  //! Get pool of class, pools are created on first use, null if not created yet and create is false
+  object_pool* Pool(const ClassInfo& info, bool create = true) const {
+    if (!static_.Contains(&info)) return Pool(static_cast<const Entry&>(info).pool, info, create);
+
+    // - Created without lock, lookup may run under writer mutex; loser of the race deletes its copy
+    const std::size_t index = static_cast<std::size_t>(&info - static_.classes);
+    std::atomic<object_pool*>* pools = static_pools_.load(std::memory_order_acquire);
+    if (!pools && !create) return nullptr;
+    if (!pools) {
+      std::atomic<object_pool*>* created = new std::atomic<object_pool*>[static_.count]();
+      if (static_pools_.compare_exchange_strong(pools, created, std::memory_order_acq_rel, std::memory_order_acquire)) pools = created;
+      else delete[] created;
+    }
+    return Pool(pools[index], info, create);
+  }
+
+  //! Get pool stored in given place, create it if there is none yet and create is true
+  static object_pool* Pool(std::atomic<object_pool*>& place, const ClassInfo& info, bool create) {
+    object_pool* pool = place.load(std::memory_order_acquire);
+    return pool || !create ? pool : CreatePool(place, info);
+  }
+
+  //! Create pool in given place unless other thread did first, kept out of line so lookup stays small
+  [[gnu::noinline]] static object_pool* CreatePool(std::atomic<object_pool*>& place, const ClassInfo& info) {
+    object_pool* pool = nullptr;
+    object_pool* created = new object_pool(info.size, info.alignment);
+    if (place.compare_exchange_strong(pool, created, std::memory_order_acq_rel, std::memory_order_acquire)) return created;
+    delete created;
+    return pool;
+  }
+
+  //! Create instance of class found by given key with constructor arguments
+  template <class Key, class... Args>
+  Base* Construct(Key key, Args&&... args) const {
+    Found found;
+    if (!Find(key, Signature<typename std::decay<Args>::type...>::Id(), false, found)) return nullptr;
+    return Arguments<typename std::decay<Args>::type...>(&found)->Construct(std::forward<Args>(args)...);
+  }
+
+  //! Create pooled instance of class found by given key with constructor arguments
+  template <class Key, class... Args>
+  InstancePtr ConstructPooled(Key key, Args&&... args) const {
+    Found found;
+    if (!Find(key, Signature<typename std::decay<Args>::type...>::Id(), true, found)) return InstancePtr();
+    const auto* factory = Arguments<typename std::decay<Args>::type...>(&found);
+    return CreatePooledInstance(found, [&](void* memory) {return factory->ConstructAt(memory, std::forward<Args>(args)...);});
+  }
+
+  //! Create array of instances of class found by given key, every instance gets copy of arguments, throws std::bad_array_new_length on size overflow
+  template <class Key, class... Args>
+  InstanceArray ConstructArray(Key key, std::size_t count, Args&&... args) const {
+    Found found;
+    if (!Find(key, Signature<typename std::decay<Args>::type...>::Id(), false, found) || !count) return InstanceArray();
+    const auto* factory = Arguments<typename std::decay<Args>::type...>(&found);
+    if (count > std::numeric_limits<std::size_t>::max() / found.size) throw std::bad_array_new_length();
+
+    InstanceArray result;
+    result.memory_ = static_cast<std::uint8_t*>(::operator new(found.size * count, std::align_val_t(found.alignment)));
+    result.alignment_ = found.alignment;
+    try {
+      factory->ConstructArray(result.memory_, count, args...);
+    } catch (...) {
+      ::operator delete(result.memory_, std::align_val_t(found.alignment));
+      result.memory_ = nullptr;
+      throw;
+    }
+    result.count_   = count;
+    result.stride_  = found.size;
+    result.offset_  = reinterpret_cast<std::uint8_t*>(found.cast(result.memory_)) - result.memory_;
+    result.destroy_ = found.destroyArray;
+    return result;
+  }
+
+  //! Create instance of found class in memory taken from its pool using given constructor call, null if it creates nothing
+  template <class Create>
+  InstancePtr CreatePooledInstance(const Found& found, Create create) const {
+    Base* instance;
+    try {
+      instance = create(found.memory);
+    } catch (...) {
+      found.pool->deallocate(found.memory);
+      throw;
+    }
+    if (!instance) {
+      found.pool->deallocate(found.memory);
+      return InstancePtr();
+    }
+    return InstancePtr(instance, InstanceDeleter(found.pool, found.destroy));
+  }
+
+  //! Get current snapshot protected by given guard, reserved guard reads it under writer mutex taken by Fallback()
+  const Registry* Acquire(hazard_domain::guard& guard) const {
+    if (guard.reserved()) return registry_.load(std::memory_order_relaxed);
+    const Registry* registry = registry_.load(std::memory_order_acquire);
+    for (;;) {
+      guard.protect(registry);
+      const Registry* current = registry_.load(std::memory_order_seq_cst);
+      if (current == registry) return registry;
+      registry = current;
+    }
+  }
+
+  //! Replace current snapshot, called under writer mutex
+  void Publish(Registry* next) {
+    Registry* previous = registry_.exchange(next, std::memory_order_seq_cst);
+    if (previous) hazard_domain::retire(previous);
+  }
+
+  //! Current snapshot of registered classes, null until the first registration
+  std::atomic<Registry*> registry_;
+
+  //! Classes known at build time and their pools, created on first use
+  StaticTable                               static_;
+  mutable std::atomic<std::atomic<object_pool*>*> static_pools_;
+
+  //! Mutex serializing registration, readers take it only when their hazard guard is reserved
   mutable std::mutex  mutex_;
 };
-
@@ -0,0 +1,413 @@
+/*
+ * DYNAMIC_JSON is JSON parser building dynamic documents
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "dynamic.h"
+
+// - Autodetect SSE2 capability
+#ifdef __SSE2__
+  #include <emmintrin.h>
+  #define __DYNAMIC_JSON__WITH_SSE2__
+#endif
+
+/**
+ * @brief JSON parser building dynamic Array and Object trees
+ *
+ * Values are built in place without intermediate tree: elements of open arrays and objects are
+ * kept on one value stack and moved into exactly sized containers when they are closed. Strings
+ * without escapes are copied straight from the input, escaped strings are decoded into a single
+ * scratch buffer reused for the whole document. String bodies and whitespace runs are scanned
+ * 16 bytes at a time with SSE2. All heap storage of the document comes from the given memory
+ * resource, dynamic_json::document parses into its own monotonic arena.
+ * Mapping: integers without fraction and exponent become int64 (uint64 above int64 range), other
+ * numbers double, true and false Int8 1 and 0, null Undefined. Object keeps the last of duplicate keys.
+ * dynamic has no boolean type, so the mapping is lossy: dynamic_writer emits booleans back as 1 and 0,
+ * [true,false] round trips to [1,0].
+ */
+class dynamic_json {
+public:
+  //! Parse error with position in the input
+  class error : public std::invalid_argument {
+  public:
+    error(const char * Message, std::size_t Offset)
+      : std::invalid_argument(std::string(Message) + " at offset " + std::to_string(Offset)), _Offset(Offset) {}
+
+    //! Get offset of invalid character
+    std::size_t offset() const {return _Offset;}
+
+  private:
+    std::size_t _Offset;
+  };
+
+  /**
+   * @brief Parsed document together with arena its values are allocated from
+   *
+   * Arena memory is released at once with the document. Values modified after parsing allocate
+   * from the arena as well, so document meant to be heavily modified should be copied out.
+   */
+  class document {
+  public:
+    explicit document(std::string_view Text)
+      : _Arena(std::max<std::size_t>(Text.size(), 1024)), _Root(dynamic_json::parse(Text, &_Arena)) {}
+
+    //! Access root value
+    const dynamic & root() const {return _Root;}
+    dynamic & root()             {return _Root;}
+
+    //! Get arena of document
+    std::pmr::memory_resource * resource() {return &_Arena;}
+
+  private:
+    document(const document&);
+    document& operator = (const document&);
+
+    //! Arena of all values
+    std::pmr::monotonic_buffer_resource _Arena;
+
+    //! Root value
+    dynamic                             _Root;
+  };
+
+  //! Maximum nesting depth of arrays and objects
+  static constexpr std::size_t max_depth = 512;
+
+  //! Parse JSON text, heap storage is allocated from given memory resource which must outlive the result
+  static dynamic parse(std::string_view Text, std::pmr::memory_resource * Resource = nullptr) {
+    dynamic_json Parser(Text, Resource ? Resource : std::pmr::get_default_resource());
+    return Parser.run();
+  }
+
+private:
+  dynamic_json(std::string_view Text, std::pmr::memory_resource * Resource)
+    : _First(Text.data()), _Position(Text.data()), _Last(Text.data() + Text.size()), _Resource(Resource) {}
+
+  //! Parse whole input
+  dynamic run() {
+    skip();
+    value(0);
+    skip();
+    if (_Position != _Last) fail("Unexpected character");
+    return std::move(_Stack.back());
+  }
+
+  //! Parse value and push it to value stack
+  void value(std::size_t Depth) {
+    switch (peek()) {
+      case '{': object(Depth + 1); break;
+      case '[': array(Depth + 1); break;
+      case '"': _Stack.emplace_back(_Resource); string(_Stack.back()); break;
+      // - Booleans are stored as Int8 1 and 0
+      case 't': literal("true");  _Stack.emplace_back(true, _Resource); break;
+      case 'f': literal("false"); _Stack.emplace_back(false, _Resource); break;
+      case 'n': literal("null");  _Stack.emplace_back(_Resource); break;
+      default:  number();
+    }
+  }
+
+  //! Parse array
+  void array(std::size_t Depth) {
+    if (Depth > max_depth) fail("Nesting too deep");
+    std::size_t Base = _Stack.size();
+    ++_Position;
+    skip();
+    if (peek() == ']') ++_Position;
+    else for (;;) {
+      value(Depth);
+      skip();
+      char Next = take();
+      if (Next == ']') break;
+      if (Next != ',') fail("Expected ',' or ']'", _Position - 1);
+      skip();
+    }
+
+    dynamic::array_type Elements(std::make_move_iterator(_Stack.begin() + Base), std::make_move_iterator(_Stack.end()), _Resource);
+    _Stack.erase(_Stack.begin() + Base, _Stack.end());
+    _Stack.emplace_back(std::move(Elements), _Resource);
+  }
+
+  //! Parse object, keys and values are pushed to value stack in turn
+  void object(std::size_t Depth) {
+    if (Depth > max_depth) fail("Nesting too deep");
+    std::size_t Base = _Stack.size();
+    ++_Position;
+    skip();
+    if (peek() == '}') ++_Position;
+    else for (;;) {
+      if (peek() != '"') fail("Expected string key");
+      _Stack.emplace_back(_Resource);
+      string(_Stack.back());
+      skip();
+      if (take() != ':') fail("Expected ':'", _Position - 1);
+      skip();
+      value(Depth);
+      skip();
+      char Next = take();
+      if (Next == '}') break;
+      if (Next != ',') fail("Expected ',' or '}'", _Position - 1);
+      skip();
+    }
+
+    // - Members are ordered by key before they are moved, stable sort keeps the last duplicate last
+    std::size_t Count = (_Stack.size() - Base) / 2;
+    _Order.resize(Count);
+    for (std::size_t Index = 0; Index < Count; ++Index) _Order[Index] = static_cast<std::uint32_t>(Index);
+    auto Less = [this, Base](std::uint32_t First, std::uint32_t Second) {
+      return _Stack[Base + 2 * First].as_string_view() < _Stack[Base + 2 * Second].as_string_view();
+    };
+    if (!std::is_sorted(_Order.begin(), _Order.end(), Less)) std::stable_sort(_Order.begin(), _Order.end(), Less);
+    dynamic::object_type Members(_Resource);
+    Members.reserve(Count);
+    for (std::uint32_t Index : _Order) Members.emplace_back(std::move(_Stack[Base + 2 * Index]), std::move(_Stack[Base + 2 * Index + 1]));
+    _Stack.erase(_Stack.begin() + Base, _Stack.end());
+    _Stack.emplace_back(std::move(Members), _Resource);
+  }
+
+  //! Parse string into given value
+  void string(dynamic & Result) {
+    const char * Start = ++_Position;
+    const char * Stop  = scan(Start);
+    if (Stop != _Last && *Stop == '"') {
+      // - No escapes, payload is copied straight from input
+      _Position = Stop + 1;
+      text(Result, Start, static_cast<std::size_t>(Stop - Start));
+      return;
+    }
+
+    _Scratch.clear();
+    for (;;) {
+      if (Stop == _Last) fail("Unterminated string", Start - 1);
+      _Scratch.insert(_Scratch.end(), _Position, Stop);
+      _Position = Stop + 1;
+      if (*Stop == '"') break;
+      if (*Stop != '\\') fail("Control character in string", Stop);
+      escape();
+      Stop = scan(_Position);
+    }
+    text(Result, _Scratch.data(), _Scratch.size());
+  }
+
+  //! Decode escape sequence following backslash into scratch buffer
+  void escape() {
+    switch (take()) {
+      case '"':   _Scratch.push_back('"'); break;
+      case '\\':  _Scratch.push_back('\\'); break;
+      case '/':   _Scratch.push_back('/'); break;
+      case 'b':   _Scratch.push_back('\b'); break;
+      case 'f':   _Scratch.push_back('\f'); break;
+      case 'n':   _Scratch.push_back('\n'); break;
+      case 'r':   _Scratch.push_back('\r'); break;
+      case 't':   _Scratch.push_back('\t'); break;
+      case 'u': {
+        std::uint32_t Code = hex();
+        if (Code >= 0xDC00 && Code <= 0xDFFF) fail("Invalid surrogate pair", _Position - 6);
+        if (Code >= 0xD800 && Code <= 0xDBFF) {
+          // - High surrogate must be followed by escaped low surrogate
+          if (_Last - _Position < 2 || _Position[0] != '\\' || _Position[1] != 'u') fail("Invalid surrogate pair");
+          _Position += 2;
+          std::uint32_t Low = hex();
+          if (Low < 0xDC00 || Low > 0xDFFF) fail("Invalid surrogate pair", _Position - 6);
+          Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+        }
+        utf8(Code);
+      }; break;
+      default: fail("Invalid escape sequence", _Position - 1);
+    }
+  }
+
+  //! Parse four hexadecimal digits
+  std::uint32_t hex() {
+    if (_Last - _Position < 4) fail("Invalid escape sequence");
+    std::uint32_t Result = 0;
+    for (int Index = 0; Index < 4; ++Index, ++_Position) {
+      char Digit = *_Position;
+      Result <<= 4;
+      if (Digit >= '0' && Digit <= '9')       Result |= static_cast<std::uint32_t>(Digit - '0');
+      else if (Digit >= 'a' && Digit <= 'f')  Result |= static_cast<std::uint32_t>(Digit - 'a' + 10);
+      else if (Digit >= 'A' && Digit <= 'F')  Result |= static_cast<std::uint32_t>(Digit - 'A' + 10);
+      else fail("Invalid escape sequence");
+    }
+    return Result;
+  }
+
+  //! Append code point to scratch buffer as UTF-8
+  void utf8(std::uint32_t Code) {
+    if (Code < 0x80) {
+      _Scratch.push_back(static_cast<char>(Code));
+    } else if (Code < 0x800) {
+      _Scratch.push_back(static_cast<char>(0xC0 | (Code >> 6)));
+      _Scratch.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+    } else if (Code < 0x10000) {
+      _Scratch.push_back(static_cast<char>(0xE0 | (Code >> 12)));
+      _Scratch.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+      _Scratch.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+    } else {
+      _Scratch.push_back(static_cast<char>(0xF0 | (Code >> 18)));
+      _Scratch.push_back(static_cast<char>(0x80 | ((Code >> 12) & 0x3F)));
+      _Scratch.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+      _Scratch.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+    }
+  }
+
+  //! Parse number
+  void number() {
+    const char * Start = _Position;
+    bool Negative = *_Position == '-';
+    if (Negative) ++_Position;
+
+    // - Integer part is accumulated on the fly, up to 19 digits always fit into 64 bits
+    const char *  Digits  = _Position;
+    std::uint64_t Integer = 0;
+    for (; _Position != _Last && digit(*_Position); ++_Position) Integer = Integer * 10 + static_cast<std::uint64_t>(*_Position - '0');
+    std::size_t Count = static_cast<std::size_t>(_Position - Digits);
+    if (!Count) fail("Invalid value", Start);
+    if (Count > 1 && *Digits == '0') fail("Leading zero in number", Digits);
+
+    bool Floating = false;
+    if (_Position != _Last && *_Position == '.') {
+      Floating = true;
+      ++_Position;
+      if (!skipDigits()) fail("Invalid number", Start);
+    }
+    if (_Position != _Last && (*_Position == 'e' || *_Position == 'E')) {
+      Floating = true;
+      ++_Position;
+      if (_Position != _Last && (*_Position == '+' || *_Position == '-')) ++_Position;
+      if (!skipDigits()) fail("Invalid number", Start);
+    }
+
+    if (!Floating && Count <= 19) {
+      if (!Negative && Integer <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) _Stack.emplace_back(static_cast<std::int64_t>(Integer), _Resource);
+      else if (!Negative) _Stack.emplace_back(Integer, _Resource);
+      else if (Integer <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + 1) _Stack.emplace_back(static_cast<std::int64_t>(0 - Integer), _Resource);
+      else _Stack.emplace_back(-static_cast<double>(Integer), _Resource);
+      return;
+    }
+    if (!Floating && !Negative) {
+      std::uint64_t Unsigned;
+      std::from_chars_result Parsed = std::from_chars(Digits, _Position, Unsigned);
+      if (Parsed.ec == std::errc()) {
+        _Stack.emplace_back(Unsigned, _Resource);
+        return;
+      }
+    }
+    double Float;
+    std::from_chars_result Parsed = std::from_chars(Start, _Position, Float);
+    if (Parsed.ec != std::errc()) fail("Number out of range", Start);
+    _Stack.emplace_back(Float, _Resource);
+  }
+
+  //! Skip decimal digits, returns false if there are none
+  bool skipDigits() {
+    const char * Start = _Position;
+    while (_Position != _Last && digit(*_Position)) ++_Position;
+    return _Position != Start;
+  }
+
+  //! Match literal
+  void literal(std::string_view Literal) {
+    if (static_cast<std::size_t>(_Last - _Position) < Literal.size() || std::memcmp(_Position, Literal.data(), Literal.size())) fail("Invalid literal");
+    _Position += Literal.size();
+  }
+
+  //! Store String value
+  static void text(dynamic & Result, const char * Data, std::size_t Size) {
+    Result.resize(Size);
+    if (Size) std::memcpy(Result.data(), Data, Size);
+    Result.setType(dynamic::Type::String);
+  }
+
+  //! Find first quote, backslash or control character
+  const char * scan(const char * First) const {
+  #ifdef __DYNAMIC_JSON__WITH_SSE2__
+    const __m128i Quote     = _mm_set1_epi8('"');
+    const __m128i Backslash = _mm_set1_epi8('\\');
+    const __m128i Control   = _mm_set1_epi8(0x1F);
+    for (; _Last - First >= 16; First += 16) {
+      __m128i Chunk   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(First));
+      __m128i Special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Chunk, Quote), _mm_cmpeq_epi8(Chunk, Backslash)),
+                                     _mm_cmpeq_epi8(_mm_max_epu8(Chunk, Control), Control));
+      if (unsigned Mask = static_cast<unsigned>(_mm_movemask_epi8(Special))) return First + __builtin_ctz(Mask);
+    }
+  #endif
+    for (; First != _Last; ++First) {
+      unsigned char Char = static_cast<unsigned char>(*First);
+      if (Char == '"' || Char == '\\' || Char < 0x20) return First;
+    }
+    return _Last;
+  }
+
+  //! Skip whitespace
+  void skip() {
+    // - Tokens are mostly separated by no or single whitespace, longer runs are indentation
+    if (_Position == _Last || !whitespace(*_Position)) return;
+    if (++_Position == _Last || !whitespace(*_Position)) return;
+  #ifdef __DYNAMIC_JSON__WITH_SSE2__
+    for (; _Last - _Position >= 16; _Position += 16) {
+      __m128i Chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_Position));
+      __m128i Space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(Chunk, _mm_set1_epi8('\n'))),
+                                   _mm_or_si128(_mm_cmpeq_epi8(Chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(Chunk, _mm_set1_epi8('\t'))));
+      if (unsigned Mask = ~static_cast<unsigned>(_mm_movemask_epi8(Space)) & 0xFFFF) {
+        _Position += __builtin_ctz(Mask);
+        return;
+      }
+    }
+  #endif
+    while (_Position != _Last && whitespace(*_Position)) ++_Position;
+  }
+
+  //! Get current character, fails at end of input
+  char peek() const {
+    if (_Position == _Last) fail("Unexpected end of input");
+    return *_Position;
+  }
+
+  //! Get current character and move to next one, fails at end of input
+  char take() {
+    char Result = peek();
+    ++_Position;
+    return Result;
+  }
+
+  static bool whitespace(char Char) {return Char == ' ' || Char == '\n' || Char == '\r' || Char == '\t';}
+  static bool digit(char Char)      {return Char >= '0' && Char <= '9';}
+
+  //! Throw parse error at current position
+  [[noreturn]] void fail(const char * Message) const {
+    fail(Message, _Position);
+  }
+
+  //! Throw parse error at given position
+  [[noreturn]] void fail(const char * Message, const char * Where) const {
+    throw error(Message, static_cast<std::size_t>(Where - _First));
+  }
+
+  //! Input
+  const char                  * _First;
+  const char                  * _Position;
+  const char                  * _Last;
+
+  //! Memory resource of document
+  std::pmr::memory_resource   * _Resource;
+
+  //! Values of open arrays and objects
+  std::vector<dynamic>          _Stack;
+
+  //! Decoded escaped string
+  std::vector<char>             _Scratch;
+
+  //! Order of members of object being closed
+  std::vector<std::uint32_t>    _Order;
+};
@@ -0,0 +1,445 @@
+/*
+ * DYNAMIC_STORE is memory mapped persistent store of keyed dynamic values
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeinfo>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dynamic.h"
+#include "dynamic_wire.h"
+
+/**
+ * @brief Persistent hash table of dynamic values keyed by string, kept in memory mapped file
+ *
+ * File layout, host byte order (file of other byte order is rejected):
+ *  - header
+ *  - open addressing table of fixed size slots, power of two of them, probed linearly
+ *  - heap of keys and payloads larger than slot inline storage, addressed by offset
+ * Opening maps the file and validates header and slots, file whose keys or payloads point outside
+ * of the heap is rejected. Lookups probe the mapped table and return dynamic_view pointing into the
+ * mapping, so nothing is deserialized. Values carry dynamic_wire tags, numeric payloads are little
+ * endian; Array and Object values are not stored.
+ * Heap is append only: updated and erased payloads become garbage, which is reclaimed by
+ * compact() rewriting live records into new file renamed over the old one. Compaction runs
+ * automatically when garbage exceeds half of the heap, table grows the same way when 3/4 of slots
+ * are used. Views are valid until next put(), erase() or compact(). Store is not thread safe for
+ * writers. Changes are made durable by sync(), file is not crash consistent between syncs.
+ */
+class dynamic_store {
+public:
+  //! Largest payload kept inline in slot
+  static constexpr std::size_t inline_capacity = 32;
+
+  //! Initial number of slots and heap size of new file
+  static constexpr std::size_t initial_slots  = 64;
+  static constexpr std::size_t initial_heap   = 4096;
+
+  //! Garbage size below which heap is never compacted automatically
+  static constexpr std::size_t compaction_threshold = 1 << 20;
+
+  //! Open store file, new empty file is created when it does not exist
+  explicit dynamic_store(const std::string & Path) : dynamic_store(Path, 0, 0) {}
+
+  dynamic_store(dynamic_store && Store) noexcept
+    : _Path(std::move(Store._Path)), _File(Store._File), _Map(Store._Map), _MapSize(Store._MapSize) {
+    Store._File = -1;
+    Store._Map  = nullptr;
+  }
+
+  //! Destructor, file is unmapped without sync
+  ~dynamic_store() {
+    close();
+  }
+
+public:
+  //! Get number of stored values
+  std::size_t size() const {return static_cast<std::size_t>(head().Live);}
+
+  //! Get number of heap bytes held by updated and erased values
+  std::size_t garbage() const {return static_cast<std::size_t>(head().Garbage);}
+
+  //! Find value by key, returns false when key is not stored
+  bool find(std::string_view Key, dynamic_view & Result) const {
+    const slot * Slot = lookup(Key, hash(Key));
+    if (!Slot || Slot->State != used) return false;
+    Result = view(*Slot);
+    return true;
+  }
+
+  //! Check is key stored
+  bool contains(std::string_view Key) const {
+    const slot * Slot = lookup(Key, hash(Key));
+    return Slot && Slot->State == used;
+  }
+
+  //! Get value by key
+  dynamic_view at(std::string_view Key) const {
+    dynamic_view Result;
+    if (!find(Key, Result)) throw std::out_of_range("Key not found");
+    return Result;
+  }
+
+  //! Insert or replace value
+  void put(std::string_view Key, const dynamic & Value) {
+    dynamic::Kind Kind = Value.kind();
+    if (!dynamic_wire::encodable(Kind)) throw std::bad_cast();
+
+    // - Numeric payload is stored little endian
+    std::uint8_t Numeric[8];
+    const std::uint8_t * Data = Value.data();
+    std::size_t Width = dynamic_wire::width(Kind);
+    if (Width) {
+      dynamic_wire::copyLittleEndian(Numeric, Value.data(), Width);
+      Data = Numeric;
+    }
+    store(Key, dynamic_wire::tag(Value), Data, Kind == dynamic::Kind::Undefined ? 0 : Value.size());
+  }
+
+  //! Remove value, returns false when key is not stored
+  bool erase(std::string_view Key) {
+    slot * Slot = const_cast<slot*>(lookup(Key, hash(Key)));
+    if (!Slot || Slot->State != used) return false;
+    header & Header = head();
+    Header.Garbage += Slot->KeySize + (Slot->Size > inline_capacity ? Slot->Size : 0);
+    Slot->State = erased;
+    --Header.Live;
+    if (Header.Garbage > compaction_threshold && Header.Garbage * 2 > Header.HeapSize) compact();
+    return true;
+  }
+
+  //! Call function with key and value of every stored value
+  template <typename Function>
+  void forEach(Function && Callback) const {
+    const header & Header = head();
+    for (std::uint64_t Index = 0; Index < Header.Slots; ++Index) {
+      const slot & Slot = slots()[Index];
+      if (Slot.State == used) Callback(key(Slot), view(Slot));
+    }
+  }
+
+  //! Rewrite live values into new file without garbage, table is sized for twice the number of values
+  void compact() {
+    rebuild(std::max<std::uint64_t>(head().Live * 2, initial_slots));
+  }
+
+  //! Write changes to disk
+  void sync() {
+    if (msync(_Map, _MapSize, MS_SYNC)) fail("msync");
+  }
+
+private:
+  dynamic_store(const dynamic_store&);
+  dynamic_store& operator = (const dynamic_store&);
+
+  //! File format version
+  static constexpr std::uint32_t version = 1;
+
+  //! Byte order mark
+  static constexpr std::uint32_t byte_order = 0x01020304;
+
+  //! File header
+  struct header {
+    char          Magic[8];
+    std::uint32_t Version;
+    std::uint32_t ByteOrder;
+    //! Number of slots, power of two
+    std::uint64_t Slots;
+    //! Slots used by stored and erased values
+    std::uint64_t Used;
+    //! Stored values
+    std::uint64_t Live;
+    //! Used heap bytes
+    std::uint64_t HeapSize;
+    //! Heap bytes held by updated and erased values
+    std::uint64_t Garbage;
+    std::uint64_t Reserved;
+  };
+
+  //! Slot state
+  enum : std::uint8_t {empty = 0, used = 1, erased = 2};
+
+  //! Table slot, payload is inline when it fits, otherwise Payload holds heap offset
+  struct slot {
+    std::uint64_t Hash;
+    std::uint64_t Key;
+    std::uint32_t KeySize;
+    std::uint32_t Size;
+    std::uint8_t  State;
+    std::uint8_t  Tag;
+    std::uint8_t  Reserved[6];
+    std::uint8_t  Payload[inline_capacity];
+  };
+
+  static_assert(sizeof(header) == 64 && sizeof(slot) == 64, "Unexpected layout of store file");
+
+  //! Open or create file with given table and heap size, zero for defaults
+  dynamic_store(const std::string & Path, std::uint64_t Slots, std::uint64_t Heap) : _Path(Path), _File(-1), _Map(nullptr), _MapSize(0) {
+    _File = ::open(Path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_File < 0) fail("open");
+    try {
+      struct stat Status;
+      if (fstat(_File, &Status)) fail("fstat");
+      if (Status.st_size) {
+        map(static_cast<std::size_t>(Status.st_size));
+        validate();
+      } else create(Slots ? Slots : initial_slots, Heap ? Heap : initial_heap);
+    } catch (...) {
+      close();
+      throw;
+    }
+  }
+
+  //! Initialize empty file
+  void create(std::uint64_t Slots, std::uint64_t Heap) {
+    resize(sizeof(header) + Slots * sizeof(slot) + Heap);
+    header & Header = head();
+    std::memcpy(Header.Magic, "DYNSTORE", sizeof(Header.Magic));
+    Header.Version    = version;
+    Header.ByteOrder  = byte_order;
+    Header.Slots      = Slots;
+  }
+
+  //! Check header and every slot of opened file, keys and payloads must lie within heap, file is not modified
+  void validate() const {
+    if (_MapSize < sizeof(header)) invalid();
+    const header & Header = head();
+    if (std::memcmp(Header.Magic, "DYNSTORE", sizeof(Header.Magic)) || Header.Version != version ||
+        Header.ByteOrder != byte_order || !Header.Slots || (Header.Slots & (Header.Slots - 1)) ||
+        Header.Slots > (_MapSize - sizeof(header)) / sizeof(slot) || Header.HeapSize > _MapSize - heapOffset() ||
+        Header.Garbage > Header.HeapSize || Header.Used > Header.Slots) {
+      invalid();
+    }
+
+    std::uint64_t Used = 0, Live = 0;
+    for (std::uint64_t Index = 0; Index < Header.Slots; ++Index) {
+      const slot & Slot = slots()[Index];
+      if (Slot.State == empty) continue;
+      if (Slot.State != used && Slot.State != erased) invalid();
+      ++Used;
+      if (Slot.Key > Header.HeapSize || Slot.KeySize > Header.HeapSize - Slot.Key) invalid();
+      if (Slot.State == erased) continue;
+      ++Live;
+      dynamic::Kind Kind  = dynamic_wire::kindOf(Slot.Tag);
+      std::size_t   Width = dynamic_wire::width(Kind);
+      if (!dynamic_wire::encodable(Kind) || (Width && Slot.Size != Width) || (Kind == dynamic::Kind::Undefined && Slot.Size)) invalid();
+      if (Slot.Size > inline_capacity) {
+        std::uint64_t Offset;
+        std::memcpy(&Offset, Slot.Payload, sizeof(Offset));
+        if (Offset > Header.HeapSize || Slot.Size > Header.HeapSize - Offset) invalid();
+      }
+    }
+    if (Used != Header.Used || Live != Header.Live) invalid();
+  }
+
+  //! Reject opened file
+  [[noreturn]] void invalid() const {
+    throw std::runtime_error("Invalid store file " + _Path);
+  }
+
+  //! Hash of key, stable between runs
+  static std::uint64_t hash(std::string_view Key) {
+    auto Mix = [](std::uint64_t Value) {
+      Value = (Value ^ (Value >> 33)) * 0xFF51AFD7ED558CCDull;
+      Value = (Value ^ (Value >> 33)) * 0xC4CEB9FE1A85EC53ull;
+      return Value ^ (Value >> 33);
+    };
+    std::uint64_t Result = 0x9E3779B97F4A7C15ull ^ Key.size();
+    const char *  Data   = Key.data();
+    std::size_t   Size   = Key.size();
+    for (; Size >= 8; Data += 8, Size -= 8) {
+      std::uint64_t Word;
+      std::memcpy(&Word, Data, 8);
+      Result = Mix(Result ^ Word);
+    }
+    std::uint64_t Tail = 0;
+    std::memcpy(&Tail, Data, Size);
+    return Mix(Result ^ Tail);
+  }
+
+  //! Find slot of key, or slot where key is to be inserted, null when table has no free slot
+  const slot * lookup(std::string_view Key, std::uint64_t Hash) const {
+    const header & Header = head();
+    const slot * Erased = nullptr;
+    std::uint64_t Mask = Header.Slots - 1;
+    for (std::uint64_t Index = Hash & Mask, Probe = 0; Probe <= Mask; Index = (Index + 1) & Mask, ++Probe) {
+      const slot & Slot = slots()[Index];
+      if (Slot.State == empty) return Erased ? Erased : &Slot;
+      if (Slot.State == erased) {
+        if (!Erased) Erased = &Slot;
+      } else if (Slot.Hash == Hash && key(Slot) == Key) return &Slot;
+    }
+    return Erased;
+  }
+
+  //! Insert or replace raw value
+  void store(std::string_view Key, std::uint8_t Tag, const std::uint8_t * Data, std::size_t Size) {
+    if (Size > std::numeric_limits<std::uint32_t>::max() || Key.size() > std::numeric_limits<std::uint32_t>::max()) throw std::length_error("Value too large");
+    std::uint64_t Hash = hash(Key);
+    slot * Slot = const_cast<slot*>(lookup(Key, Hash));
+
+    // - New key in table with 3/4 of slots used grows the table first
+    if (!Slot || (Slot->State != used && (head().Used + 1) * 4 > head().Slots * 3)) {
+      rebuild(std::max<std::uint64_t>(head().Live * 2 + 2, head().Slots));
+      Slot = const_cast<slot*>(lookup(Key, Hash));
+    }
+
+    // - Heap room is reserved before any pointer into the mapping is taken
+    std::size_t Heap = (Slot->State == used ? 0 : Key.size()) + (Size > inline_capacity ? Size : 0);
+    if (heapOffset() + head().HeapSize + Heap > _MapSize) {
+      std::size_t Index = static_cast<std::size_t>(Slot - slots());
+      resize(std::max<std::size_t>(_MapSize * 2, heapOffset() + head().HeapSize + Heap));
+      Slot = slots() + Index;
+    }
+
+    header & Header = head();
+    if (Slot->State == used) {
+      if (Slot->Size > inline_capacity) Header.Garbage += Slot->Size;
+    } else {
+      if (Slot->State == empty) ++Header.Used;
+      ++Header.Live;
+      Slot->Hash    = Hash;
+      Slot->Key     = allocate(Key.data(), Key.size());
+      Slot->KeySize = static_cast<std::uint32_t>(Key.size());
+    }
+    Slot->Tag   = Tag;
+    Slot->Size  = static_cast<std::uint32_t>(Size);
+    if (Size > inline_capacity) {
+      std::uint64_t Offset = allocate(Data, Size);
+      std::memcpy(Slot->Payload, &Offset, sizeof(Offset));
+    } else if (Size) std::memcpy(Slot->Payload, Data, Size);
+    Slot->State = used;
+
+    if (Header.Garbage > compaction_threshold && Header.Garbage * 2 > Header.HeapSize) compact();
+  }
+
+  //! Copy data to the end of heap, room must be reserved, returns heap offset
+  std::uint64_t allocate(const void * Data, std::size_t Size) {
+    header & Header = head();
+    std::uint64_t Offset = Header.HeapSize;
+    if (Size) std::memcpy(heap() + Offset, Data, Size);
+    Header.HeapSize += Size;
+    return Offset;
+  }
+
+  //! Rewrite live values into new file with given number of slots, rounded up to power of two
+  void rebuild(std::uint64_t Slots) {
+    std::uint64_t Capacity = initial_slots;
+    while (Capacity < Slots) Capacity *= 2;
+
+    // - Live keys and payloads are copied to new file with exactly sized heap
+    std::string   Temporary = _Path + ".compact";
+    std::uint64_t Heap      = std::max<std::uint64_t>(head().HeapSize - head().Garbage, initial_heap);
+    ::unlink(Temporary.c_str());
+    dynamic_store Target(Temporary, Capacity, Heap);
+    forEach([&Target](std::string_view Key, const dynamic_view & Value) {
+      Target.store(Key, Value.tag(), Value.data(), Value.size());
+    });
+
+    // - New file is on disk before it replaces the old one, and the rename before old file is dropped
+    Target.sync();
+    if (::fsync(Target._File)) fail("fsync");
+    if (::rename(Temporary.c_str(), _Path.c_str())) fail("rename");
+    syncDirectory();
+
+    // - Take over mapping of new file
+    close();
+    _File         = Target._File;
+    _Map          = Target._Map;
+    _MapSize      = Target._MapSize;
+    Target._File  = -1;
+    Target._Map   = nullptr;
+  }
+
+  //! Make rename in directory of store file durable
+  void syncDirectory() const {
+    std::string::size_type Separator = _Path.rfind('/');
+    std::string Directory = Separator == std::string::npos ? std::string(".") : _Path.substr(0, Separator ? Separator : 1);
+    int File = ::open(Directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (File < 0) fail("open");
+    int Result = ::fsync(File);
+    int Error  = errno;
+    ::close(File);
+    errno = Error;
+    if (Result) fail("fsync");
+  }
+
+  //! Resize file and map it again
+  void resize(std::size_t Size) {
+    if (ftruncate(_File, static_cast<off_t>(Size))) fail("ftruncate");
+    if (_Map) munmap(_Map, _MapSize);
+    _Map = nullptr;
+    map(Size);
+  }
+
+  //! Map whole file
+  void map(std::size_t Size) {
+    void * Map = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, _File, 0);
+    if (Map == MAP_FAILED) fail("mmap");
+    _Map      = static_cast<std::uint8_t*>(Map);
+    _MapSize  = Size;
+  }
+
+  //! Unmap and close file
+  void close() noexcept {
+    if (_Map) munmap(_Map, _MapSize);
+    if (_File >= 0) ::close(_File);
+    _Map  = nullptr;
+    _File = -1;
+  }
+
+  //! Throw error of failed system call
+  [[noreturn]] void fail(const char * Call) const {
+    throw std::system_error(errno, std::generic_category(), std::string(Call) + " " + _Path);
+  }
+
+  //! Access mapped structures
+  header & head()             {return *reinterpret_cast<header*>(_Map);}
+  const header & head() const {return *reinterpret_cast<const header*>(_Map);}
+  slot * slots()              {return reinterpret_cast<slot*>(_Map + sizeof(header));}
+  const slot * slots() const  {return reinterpret_cast<const slot*>(_Map + sizeof(header));}
+  std::uint8_t * heap()       {return _Map + heapOffset();}
+  const std::uint8_t * heap() const {return _Map + heapOffset();}
+
+  //! Get file offset of heap
+  std::size_t heapOffset() const {
+    return sizeof(header) + static_cast<std::size_t>(head().Slots) * sizeof(slot);
+  }
+
+  //! Get key of slot
+  std::string_view key(const slot & Slot) const {
+    return std::string_view(reinterpret_cast<const char*>(heap() + Slot.Key), Slot.KeySize);
+  }
+
+  //! Get value of slot
+  dynamic_view view(const slot & Slot) const {
+    if (Slot.Size <= inline_capacity) return dynamic_view(Slot.Tag, Slot.Payload, Slot.Size);
+    std::uint64_t Offset;
+    std::memcpy(&Offset, Slot.Payload, sizeof(Offset));
+    return dynamic_view(Slot.Tag, heap() + Offset, Slot.Size);
+  }
+
+private:
+  //! Path of store file
+  std::string     _Path;
+
+  //! Open store file
+  int             _File;
+
+  //! Mapping of whole file
+  std::uint8_t  * _Map;
+  std::size_t     _MapSize;
+};
@@ -0,0 +1,414 @@
+/*
+ * DYNAMIC_WIRE is compact binary encoding for dynamic values
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include "dynamic.h"
+
+/**
+ * Wire format of a single value:
+ *  - one tag byte, dynamic_wire::Tag of the value
+ *  - numeric kinds: payload of the kind width, little endian
+ *  - String, Binary and UUID: unsigned LEB128 varint length followed by payload
+ *  - Undefined: tag only
+ * Array and Object values are not encoded.
+ * Batch is varint number of values followed by the values.
+ */
+namespace dynamic_wire {
+  //! Tag byte of encoded value, values are part of the format and must never change
+  enum class Tag : std::uint8_t {
+    Undefined = 0,
+    Int8      = 1,
+    Int16     = 2,
+    Int32     = 3,
+    Int64     = 4,
+    UInt8     = 5,
+    UInt16    = 6,
+    UInt32    = 7,
+    UInt64    = 8,
+    Float32   = 9,
+    Float64   = 10,
+    String    = 11,
+    Binary    = 12,
+    //! 13 is reserved, it was never written
+    UUID      = 14,
+  };
+
+  //! Tag of UUID values
+  constexpr std::uint8_t uuid_tag = static_cast<std::uint8_t>(Tag::UUID);
+
+  //! Tag of value kind, kinds without encoding have no tag
+  inline std::uint8_t tagOf(dynamic::Kind Kind) {
+    switch (Kind) {
+      case dynamic::Kind::Undefined:  return static_cast<std::uint8_t>(Tag::Undefined);
+      case dynamic::Kind::Int8:       return static_cast<std::uint8_t>(Tag::Int8);
+      case dynamic::Kind::Int16:      return static_cast<std::uint8_t>(Tag::Int16);
+      case dynamic::Kind::Int32:      return static_cast<std::uint8_t>(Tag::Int32);
+      case dynamic::Kind::Int64:      return static_cast<std::uint8_t>(Tag::Int64);
+      case dynamic::Kind::UInt8:      return static_cast<std::uint8_t>(Tag::UInt8);
+      case dynamic::Kind::UInt16:     return static_cast<std::uint8_t>(Tag::UInt16);
+      case dynamic::Kind::UInt32:     return static_cast<std::uint8_t>(Tag::UInt32);
+      case dynamic::Kind::UInt64:     return static_cast<std::uint8_t>(Tag::UInt64);
+      case dynamic::Kind::Float32:    return static_cast<std::uint8_t>(Tag::Float32);
+      case dynamic::Kind::Float64:    return static_cast<std::uint8_t>(Tag::Float64);
+      case dynamic::Kind::String:     return static_cast<std::uint8_t>(Tag::String);
+      case dynamic::Kind::Binary:     return static_cast<std::uint8_t>(Tag::Binary);
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Kind of tagged value, UUID is Binary, Invalid for unknown tags
+  inline dynamic::Kind kindOf(std::uint8_t Value) {
+    switch (static_cast<Tag>(Value)) {
+      case Tag::Undefined:  return dynamic::Kind::Undefined;
+      case Tag::Int8:       return dynamic::Kind::Int8;
+      case Tag::Int16:      return dynamic::Kind::Int16;
+      case Tag::Int32:      return dynamic::Kind::Int32;
+      case Tag::Int64:      return dynamic::Kind::Int64;
+      case Tag::UInt8:      return dynamic::Kind::UInt8;
+      case Tag::UInt16:     return dynamic::Kind::UInt16;
+      case Tag::UInt32:     return dynamic::Kind::UInt32;
+      case Tag::UInt64:     return dynamic::Kind::UInt64;
+      case Tag::Float32:    return dynamic::Kind::Float32;
+      case Tag::Float64:    return dynamic::Kind::Float64;
+      case Tag::String:     return dynamic::Kind::String;
+      case Tag::Binary:
+      case Tag::UUID:       return dynamic::Kind::Binary;
+    }
+    return dynamic::Kind::Invalid;
+  }
+
+  //! Maximum size of encoded varint
+  constexpr std::size_t max_varint_size = 10;
+
+  //! Get width of numeric kind, zero for other kinds
+  inline std::size_t width(dynamic::Kind Kind) {
+    switch (Kind) {
+      case dynamic::Kind::Int8:   case dynamic::Kind::UInt8:                                return 1;
+      case dynamic::Kind::Int16:  case dynamic::Kind::UInt16:                               return 2;
+      case dynamic::Kind::Int32:  case dynamic::Kind::UInt32: case dynamic::Kind::Float32:  return 4;
+      case dynamic::Kind::Int64:  case dynamic::Kind::UInt64: case dynamic::Kind::Float64:  return 8;
+      default: return 0;
+    }
+  }
+
+  //! Copy numeric payload converting between host and little endian order
+  inline void copyLittleEndian(std::uint8_t * Target, const std::uint8_t * Source, std::size_t Size) {
+  #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::reverse_copy(Source, Source + Size, Target);
+  #else
+    std::memcpy(Target, Source, Size);
+  #endif
+  }
+
+  //! Write unsigned LEB128 varint, returns number of written bytes
+  inline std::size_t writeVarint(std::uint8_t * Target, std::uint64_t Value) {
+    std::size_t Size = 0;
+    while (Value >= 0x80) {
+      Target[Size++] = static_cast<std::uint8_t>(Value | 0x80);
+      Value >>= 7;
+    }
+    Target[Size++] = static_cast<std::uint8_t>(Value);
+    return Size;
+  }
+
+  //! Get size of encoded varint
+  inline std::size_t varintSize(std::uint64_t Value) {
+    std::size_t Size = 1;
+    while (Value >= 0x80) {
+      Value >>= 7;
+      ++Size;
+    }
+    return Size;
+  }
+
+  //! Check is kind encodable
+  inline bool encodable(dynamic::Kind Kind) {
+    return Kind != dynamic::Kind::Invalid && Kind != dynamic::Kind::Array && Kind != dynamic::Kind::Object;
+  }
+
+  //! Get tag of value
+  inline std::uint8_t tag(const dynamic & Value) {
+  #ifdef __DYNAMIC__WITH_UUIDPP__
+    if (Value.type() == dynamic::Type::UUID) return uuid_tag;
+  #endif
+    return tagOf(Value.kind());
+  }
+
+  //! Get size of encoded value
+  inline std::size_t encodedSize(const dynamic & Value) {
+    dynamic::Kind Kind = Value.kind();
+    if (Kind == dynamic::Kind::String || Kind == dynamic::Kind::Binary) return 1 + varintSize(Value.size()) + Value.size();
+    return 1 + width(Kind);
+  }
+}
+
+/**
+ * @brief Non-owning view on encoded dynamic value
+ *
+ * Payload points into the decoded buffer, which must outlive the view.
+ */
+class dynamic_view {
+public:
+  dynamic_view() : _Tag(static_cast<std::uint8_t>(dynamic_wire::Tag::Undefined)), _Data(nullptr), _Size(0) {}
+  dynamic_view(std::uint8_t Tag, const std::uint8_t * Data, std::size_t Size) : _Tag(Tag), _Data(Data), _Size(Size) {}
+
+public:
+  //! Get kind of value, UUID is reported as Binary
+  dynamic::Kind kind() const {
+    return dynamic_wire::kindOf(_Tag);
+  }
+
+  //! Get stored type
+  dynamic::Type type() const {
+    switch (kind()) {
+      case dynamic::Kind::Undefined:  return dynamic::Type::Undefined;
+      case dynamic::Kind::Int8:   case dynamic::Kind::Int16:  case dynamic::Kind::Int32:  case dynamic::Kind::Int64:  return dynamic::Type::SignedInt;
+      case dynamic::Kind::UInt8:  case dynamic::Kind::UInt16: case dynamic::Kind::UInt32: case dynamic::Kind::UInt64: return dynamic::Type::UnsignedInt;
+      case dynamic::Kind::Float32: case dynamic::Kind::Float64: return dynamic::Type::Float;
+      case dynamic::Kind::String:     return dynamic::Type::String;
+    #ifdef __DYNAMIC__WITH_UUIDPP__
+      default: return _Tag == dynamic_wire::uuid_tag ? dynamic::Type::UUID : dynamic::Type::Binary;
+    #else
+      default: return dynamic::Type::Binary;
+    #endif
+    }
+  }
+
+  //! Get wire tag
+  std::uint8_t tag() const {return _Tag;}
+
+  //! Get size of payload
+  std::size_t size() const {return _Size;}
+
+  //! Access payload, numeric payload is little endian
+  const std::uint8_t * data() const {return _Data;}
+
+  //! Access payload without copying
+  dynamic::span as_span() const {return dynamic::span(_Data, _Size);}
+
+  //! Access String or Binary payload as text without copying
+  std::string_view as_string_view() const {
+    switch (kind()) {
+      case dynamic::Kind::Undefined:  return std::string_view();
+      case dynamic::Kind::String:
+      case dynamic::Kind::Binary:     return std::string_view(reinterpret_cast<const char*>(_Data), _Size);
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Read numeric payload as given type, kind must match exactly
+  template <typename T>
+  T get() const {
+    if (dynamic_wire::width(kind()) != sizeof(T)) throw std::bad_cast();
+    T Result;
+    dynamic_wire::copyLittleEndian(reinterpret_cast<std::uint8_t*>(&Result), _Data, sizeof(T));
+    return Result;
+  }
+
+  //! Create owning dynamic value
+  dynamic materialize() const {
+    dynamic Result;
+    if (kind() == dynamic::Kind::Undefined) return Result;
+    Result.resize(_Size);
+    if (dynamic_wire::width(kind())) dynamic_wire::copyLittleEndian(Result.data(), _Data, _Size);
+    else std::memcpy(Result.data(), _Data, _Size);
+    Result.setType(type());
+    return Result;
+  }
+
+  //! Cast to specified type through owning dynamic value
+  template <typename T>
+  T cast() const {
+    return materialize().cast<T>();
+  }
+
+private:
+  //! Wire tag
+  std::uint8_t          _Tag;
+
+  //! Payload
+  const std::uint8_t  * _Data;
+
+  //! Size of payload
+  std::size_t           _Size;
+};
+
+/**
+ * @brief Streaming encoder for dynamic values
+ *
+ * Values are written into caller supplied buffer. When sink is given, full buffer is flushed to it
+ * and large payloads are passed to the sink directly (call flush() after the last value), otherwise
+ * std::overflow_error is thrown when buffer is exhausted.
+ */
+class dynamic_encoder {
+public:
+  //! Consumer of encoded data
+  typedef std::function<void(const std::uint8_t *, std::size_t)> sink;
+
+  dynamic_encoder(std::uint8_t * Buffer, std::size_t BufferSize, sink Sink = sink())
+    : _Buffer(Buffer), _Capacity(BufferSize), _Size(0), _Sink(std::move(Sink)) {}
+
+public:
+  //! Encode single value
+  void write(const dynamic & Value) {
+    std::uint8_t  Header[1 + dynamic_wire::max_varint_size];
+    std::size_t   HeaderSize  = 0;
+    dynamic::Kind Kind        = Value.kind();
+    if (!dynamic_wire::encodable(Kind)) throw std::bad_cast();
+
+    Header[HeaderSize++] = dynamic_wire::tag(Value);
+    std::size_t Width = dynamic_wire::width(Kind);
+    if (Width) {
+      reserve(HeaderSize + Width);
+      std::memcpy(_Buffer + _Size, Header, HeaderSize);
+      dynamic_wire::copyLittleEndian(_Buffer + _Size + HeaderSize, Value.data(), Width);
+      _Size += HeaderSize + Width;
+      return;
+    }
+    if (Kind != dynamic::Kind::Undefined) HeaderSize += dynamic_wire::writeVarint(Header + HeaderSize, Value.size());
+    append(Header, HeaderSize);
+    append(Value.data(), Kind == dynamic::Kind::Undefined ? 0 : Value.size());
+  }
+
+  //! Encode batch of values
+  template <typename Iterator>
+  void write(Iterator First, Iterator Last) {
+    std::uint8_t Count[dynamic_wire::max_varint_size];
+    append(Count, dynamic_wire::writeVarint(Count, static_cast<std::uint64_t>(std::distance(First, Last))));
+    for (; First != Last; ++First) write(*First);
+  }
+
+  //! Pass buffered data to sink
+  void flush() {
+    if (!_Sink || !_Size) return;
+    _Sink(_Buffer, _Size);
+    _Size = 0;
+  }
+
+  //! Get number of bytes in buffer
+  std::size_t size() const {return _Size;}
+
+  //! Access buffer
+  const std::uint8_t * data() const {return _Buffer;}
+
+private:
+  //! Make room for given number of bytes in buffer
+  void reserve(std::size_t Size) {
+    if (_Capacity - _Size >= Size) return;
+    flush();
+    if (_Capacity - _Size < Size) throw std::overflow_error("Buffer to small");
+  }
+
+  //! Append raw data
+  void append(const std::uint8_t * Data, std::size_t Size) {
+    if (_Capacity - _Size >= Size) {
+      std::memcpy(_Buffer + _Size, Data, Size);
+      _Size += Size;
+      return;
+    }
+    if (!_Sink) throw std::overflow_error("Buffer to small");
+
+    // - Large payload goes to sink directly
+    flush();
+    if (Size > _Capacity) {
+      _Sink(Data, Size);
+      return;
+    }
+    std::memcpy(_Buffer, Data, Size);
+    _Size = Size;
+  }
+
+private:
+  //! Output buffer
+  std::uint8_t  * _Buffer;
+
+  //! Size of output buffer
+  std::size_t     _Capacity;
+
+  //! Number of bytes in buffer
+  std::size_t     _Size;
+
+  //! Consumer of full buffers
+  sink            _Sink;
+};
+
+/**
+ * @brief Zero-copy decoder for dynamic values
+ *
+ * Produces dynamic_view values pointing into decoded buffer.
+ */
+class dynamic_decoder {
+public:
+  dynamic_decoder(const std::uint8_t * Data, std::size_t Size) : _Data(Data), _Size(Size), _Position(0) {}
+
+public:
+  //! Check is all data decoded
+  bool atEnd() const {return _Position == _Size;}
+
+  //! Get number of decoded bytes
+  std::size_t position() const {return _Position;}
+
+  //! Decode single value
+  dynamic_view read() {
+    std::uint8_t  Tag   = take(1)[0];
+    dynamic::Kind Kind  = dynamic_wire::kindOf(Tag);
+    if (!dynamic_wire::encodable(Kind)) throw std::bad_cast();
+    if (Kind == dynamic::Kind::Undefined) return dynamic_view();
+
+    std::size_t   Size  = dynamic_wire::width(Kind);
+    if (!Size) Size = static_cast<std::size_t>(readVarint());
+    return dynamic_view(Tag, take(Size), Size);
+  }
+
+  //! Decode number of values in batch
+  std::size_t readCount() {
+    return static_cast<std::size_t>(readVarint());
+  }
+
+  //! Decode batch of values
+  void read(std::vector<dynamic_view> & Values) {
+    std::size_t Count = readCount();
+    Values.reserve(Values.size() + std::min(Count, _Size - _Position));
+    for (std::size_t i = 0; i < Count; ++i) Values.push_back(read());
+  }
+
+private:
+  //! Consume given number of bytes
+  const std::uint8_t * take(std::size_t Size) {
+    if (_Size - _Position < Size) throw std::length_error("Unexpected end of data");
+    const std::uint8_t * Result = _Data + _Position;
+    _Position += Size;
+    return Result;
+  }
+
+  //! Decode unsigned LEB128 varint
+  std::uint64_t readVarint() {
+    std::uint64_t Result = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      std::uint8_t Byte = take(1)[0];
+      Result |= static_cast<std::uint64_t>(Byte & 0x7F) << Shift;
+      if (!(Byte & 0x80)) return Result;
+    }
+    throw std::length_error("Varint too long");
+  }
+
+private:
+  //! Decoded data
+  const std::uint8_t  * _Data;
+
+  //! Size of decoded data
+  std::size_t           _Size;
+
+  //! Current position
+  std::size_t           _Position;
+};
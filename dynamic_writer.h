@@ -0,0 +1,367 @@
+/*
+ * DYNAMIC_WRITER is streaming text and JSON writer for dynamic values
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include "dynamic.h"
+
+// - Autodetect SSE2 capability
+#ifdef __SSE2__
+  #include <emmintrin.h>
+  #define __DYNAMIC_WRITER__WITH_SSE2__
+#endif
+
+/**
+ * @brief Streaming writer rendering dynamic values as text or JSON
+ *
+ * Output goes either to caller supplied fixed buffer, which is passed to sink when full (call
+ * flush() after the last value), or is appended to growable std::string or std::vector<char>
+ * (trimmed to written size by flush() and destructor). Numbers are formatted by std::to_chars
+ * straight into the output and strings are copied in runs between characters needing escape,
+ * found 16 bytes at a time with SSE2, so no temporary string is created.
+ * Text format writes scalars like operator std::string() does. JSON format writes Undefined and
+ * non-finite floats as null, Binary as base64 string and Object members in key order. Strings are
+ * expected to hold UTF-8, bytes above 0x7F are copied unchanged. dynamic does not distinguish bool
+ * from int8, so bool is written as 0 or 1. Array and Object are written as JSON in both formats.
+ */
+class dynamic_writer {
+public:
+  //! Output format
+  enum class Format {Text, Json};
+
+  //! Consumer of written data
+  typedef std::function<void(const char *, std::size_t)> sink;
+
+  //! Write into fixed buffer, full buffer is passed to sink, without sink std::overflow_error is thrown
+  dynamic_writer(char * Buffer, std::size_t BufferSize, sink Sink = sink(), Format Mode = Format::Json)
+    : _Buffer(Buffer), _Capacity(BufferSize), _Size(0), _Sink(std::move(Sink)), _Output(nullptr), _Grow(nullptr), _Mode(Mode) {}
+
+  //! Append to string
+  explicit dynamic_writer(std::string & Output, Format Mode = Format::Json) : dynamic_writer(Mode) {attach(Output);}
+
+  //! Append to vector
+  explicit dynamic_writer(std::vector<char> & Output, Format Mode = Format::Json) : dynamic_writer(Mode) {attach(Output);}
+
+  //! Destructor, growable output is trimmed to written size
+  ~dynamic_writer() {
+    if (_Output) _Grow(_Output, _Size, 0, _Capacity);
+  }
+
+public:
+  //! Write single value
+  void write(const dynamic & Value) {
+    switch (Value.type()) {
+      case dynamic::Type::Undefined:
+        if (_Mode == Format::Json) raw("null");
+        return;
+      case dynamic::Type::SignedInt:
+      case dynamic::Type::UnsignedInt:
+        number(Value);
+        return;
+      case dynamic::Type::Float:
+        if (_Mode == Format::Json && !std::isfinite(Value.cast<double>())) raw("null");
+        else number(Value);
+        return;
+      case dynamic::Type::String:
+        string(Value.as_string_view());
+        return;
+      case dynamic::Type::Binary:
+        if (_Mode == Format::Json) base64(Value.data(), Value.size());
+        else append(reinterpret_cast<const char*>(Value.data()), Value.size());
+        return;
+      case dynamic::Type::Array:
+        array(Value);
+        return;
+      case dynamic::Type::Object:
+        object(Value);
+        return;
+      #ifdef __DYNAMIC__WITH_UUIDPP__
+      case dynamic::Type::UUID:
+        string(UUID::toString(Value.value().data()));
+        return;
+      #endif
+      default: throw std::bad_cast();
+    }
+  }
+
+  //! Write sequence of values, separator is written between them
+  template <typename Iterator>
+  void write(Iterator First, Iterator Last, std::string_view Separator = "\n") {
+    for (Iterator Value = First; Value != Last; ++Value) {
+      if (Value != First) raw(Separator);
+      write(*Value);
+    }
+  }
+
+  //! Write string, quoted and escaped in JSON format
+  void string(std::string_view Text) {
+    if (_Mode == Format::Text) {
+      append(Text.data(), Text.size());
+      return;
+    }
+    put('"');
+    const char * First = Text.data();
+    const char * Last  = First + Text.size();
+    while (First != Last) {
+      const char * Special = scan(First, Last);
+      append(First, static_cast<std::size_t>(Special - First));
+      if (Special == Last) break;
+      escape(static_cast<unsigned char>(*Special));
+      First = Special + 1;
+    }
+    put('"');
+  }
+
+  //! Write text as is, without escaping
+  void raw(std::string_view Text) {
+    append(Text.data(), Text.size());
+  }
+
+  //! Pass buffered data to sink, or trim growable output to written size
+  void flush() {
+    if (_Output) {
+      _Buffer = _Grow(_Output, _Size, 0, _Capacity);
+      return;
+    }
+    if (!_Sink || !_Size) return;
+    _Sink(_Buffer, _Size);
+    _Size = 0;
+  }
+
+  //! Get number of bytes in buffer
+  std::size_t size() const {return _Size;}
+
+  //! Access buffer
+  const char * data() const {return _Buffer;}
+
+private:
+  dynamic_writer(const dynamic_writer&);
+  dynamic_writer& operator = (const dynamic_writer&);
+
+  explicit dynamic_writer(Format Mode)
+    : _Buffer(nullptr), _Capacity(0), _Size(0), _Output(nullptr), _Grow(nullptr), _Mode(Mode) {}
+
+  //! Initial room reserved in growable output
+  static constexpr std::size_t initial_capacity = 256;
+
+  //! Attach growable output, written data is appended after its current content
+  template <typename Container>
+  void attach(Container & Output) {
+    _Output = &Output;
+    _Grow   = &grow<Container>;
+    _Size   = Output.size();
+    _Buffer = _Grow(_Output, _Size, initial_capacity, _Capacity);
+  }
+
+  //! Resize growable output to make room for given number of bytes after used ones, trim it to used size when zero
+  template <typename Container>
+  static char * grow(void * Output, std::size_t Used, std::size_t Size, std::size_t & Capacity) {
+    Container & Target = *static_cast<Container*>(Output);
+    if (!Size) Target.resize(Used);
+    else {
+      // - Size grows geometrically within reserved capacity, so only written part of it is cleared
+      if (Target.capacity() < Used + Size) Target.reserve(std::max(Used + Size, 2 * Target.capacity()));
+      Target.resize(std::min(Target.capacity(), std::max(Used + Size, 2 * Used)));
+    }
+    Capacity = Target.size();
+    return Target.data();
+  }
+
+  //! Make room for given number of bytes in buffer
+  void reserve(std::size_t Size) {
+    if (_Capacity - _Size >= Size) return;
+    if (_Output) {
+      _Buffer = _Grow(_Output, _Size, Size, _Capacity);
+      return;
+    }
+    flush();
+    if (_Capacity - _Size < Size) throw std::overflow_error("Buffer too small");
+  }
+
+  //! Append single character
+  void put(char Char) {
+    reserve(1);
+    _Buffer[_Size++] = Char;
+  }
+
+  //! Append raw data
+  void append(const char * Data, std::size_t Size) {
+    if (_Capacity - _Size >= Size) {
+      if (Size) std::memcpy(_Buffer + _Size, Data, Size);
+      _Size += Size;
+      return;
+    }
+    if (_Output) {
+      reserve(Size);
+      std::memcpy(_Buffer + _Size, Data, Size);
+      _Size += Size;
+      return;
+    }
+    if (!_Sink) throw std::overflow_error("Buffer too small");
+
+    // - Large payload goes to sink directly
+    flush();
+    if (Size > _Capacity) {
+      _Sink(Data, Size);
+      return;
+    }
+    std::memcpy(_Buffer, Data, Size);
+    _Size = Size;
+  }
+
+  //! Format numeric value in place
+  void number(const dynamic & Value) {
+    reserve(dynamic::max_numeric_length);
+    _Size += Value.format_to(_Buffer + _Size, dynamic::max_numeric_length);
+  }
+
+  //! Write elements of Array
+  void array(const dynamic & Value) {
+    put('[');
+    const dynamic::array_type & Elements = Value.elements();
+    for (auto Element = Elements.begin(); Element != Elements.end(); ++Element) {
+      if (Element != Elements.begin()) put(',');
+      json(*Element);
+    }
+    put(']');
+  }
+
+  //! Write members of Object
+  void object(const dynamic & Value) {
+    put('{');
+    const dynamic::object_type & Members = Value.members();
+    for (auto Member = Members.begin(); Member != Members.end(); ++Member) {
+      if (Member != Members.begin()) put(',');
+      json(Member->first);
+      put(':');
+      json(Member->second);
+    }
+    put('}');
+  }
+
+  //! Write element of Array or Object, always in JSON format
+  void json(const dynamic & Value) {
+    if (_Mode == Format::Json) {
+      write(Value);
+      return;
+    }
+    _Mode = Format::Json;
+    try {
+      write(Value);
+    } catch (...) {
+      _Mode = Format::Text;
+      throw;
+    }
+    _Mode = Format::Text;
+  }
+
+  //! Write escape sequence of given character
+  void escape(unsigned char Char) {
+    static constexpr char Digits[] = "0123456789abcdef";
+    reserve(6);
+    char * Output = _Buffer + _Size;
+    Output[0] = '\\';
+    switch (Char) {
+      case '"':   Output[1] = '"';  _Size += 2; return;
+      case '\\':  Output[1] = '\\'; _Size += 2; return;
+      case '\b':  Output[1] = 'b';  _Size += 2; return;
+      case '\f':  Output[1] = 'f';  _Size += 2; return;
+      case '\n':  Output[1] = 'n';  _Size += 2; return;
+      case '\r':  Output[1] = 'r';  _Size += 2; return;
+      case '\t':  Output[1] = 't';  _Size += 2; return;
+      default:
+        std::memcpy(Output + 1, "u00", 3);
+        Output[4] = Digits[Char >> 4];
+        Output[5] = Digits[Char & 0xF];
+        _Size += 6;
+    }
+  }
+
+  //! Find first quote, backslash or control character
+  static const char * scan(const char * First, const char * Last) {
+  #ifdef __DYNAMIC_WRITER__WITH_SSE2__
+    const __m128i Quote     = _mm_set1_epi8('"');
+    const __m128i Backslash = _mm_set1_epi8('\\');
+    const __m128i Control   = _mm_set1_epi8(0x1F);
+    for (; Last - First >= 16; First += 16) {
+      __m128i Chunk   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(First));
+      __m128i Special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Chunk, Quote), _mm_cmpeq_epi8(Chunk, Backslash)),
+                                     _mm_cmpeq_epi8(_mm_max_epu8(Chunk, Control), Control));
+      if (unsigned Mask = static_cast<unsigned>(_mm_movemask_epi8(Special))) return First + __builtin_ctz(Mask);
+    }
+  #endif
+    for (; First != Last; ++First) {
+      unsigned char Char = static_cast<unsigned char>(*First);
+      if (Char == '"' || Char == '\\' || Char < 0x20) return First;
+    }
+    return Last;
+  }
+
+  //! Write binary data as quoted base64
+  void base64(const std::uint8_t * Data, std::size_t Size) {
+    static constexpr char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    put('"');
+    while (Size) {
+      // - Encode in chunks fitting into buffer, fixed buffer takes as many groups as fit after flush
+      std::size_t Chunk = std::min<std::size_t>(Size, 3 * 1024);
+      if (!_Output) {
+        reserve(4);
+        Chunk = std::min(Chunk, 3 * ((_Capacity - _Size) / 4));
+      }
+      reserve(4 * ((Chunk + 2) / 3));
+      char * Output = _Buffer + _Size;
+      std::size_t Index = 0;
+      for (; Index + 3 <= Chunk; Index += 3, Output += 4) {
+        std::uint32_t Bits = std::uint32_t(Data[Index]) << 16 | std::uint32_t(Data[Index + 1]) << 8 | Data[Index + 2];
+        Output[0] = Alphabet[Bits >> 18];
+        Output[1] = Alphabet[Bits >> 12 & 0x3F];
+        Output[2] = Alphabet[Bits >> 6 & 0x3F];
+        Output[3] = Alphabet[Bits & 0x3F];
+      }
+      if (Index < Chunk) {
+        std::uint32_t Bits = std::uint32_t(Data[Index]) << 16 | (Index + 1 < Chunk ? std::uint32_t(Data[Index + 1]) << 8 : 0);
+        Output[0] = Alphabet[Bits >> 18];
+        Output[1] = Alphabet[Bits >> 12 & 0x3F];
+        Output[2] = Index + 1 < Chunk ? Alphabet[Bits >> 6 & 0x3F] : '=';
+        Output[3] = '=';
+        Output += 4;
+      }
+      _Size = static_cast<std::size_t>(Output - _Buffer);
+      Data += Chunk;
+      Size -= Chunk;
+    }
+    put('"');
+  }
+
+private:
+  //! Output buffer
+  char          * _Buffer;
+
+  //! Size of output buffer
+  std::size_t     _Capacity;
+
+  //! Number of bytes in buffer
+  std::size_t     _Size;
+
+  //! Consumer of full buffers
+  sink            _Sink;
+
+  //! Growable output and its resize function
+  void          * _Output;
+  char          * (*_Grow)(void *, std::size_t, std::size_t, std::size_t &);
+
+  //! Output format
+  Format          _Mode;
+};
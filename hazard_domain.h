@@ -0,0 +1,166 @@
+/*
+ * HAZARD_DOMAIN is safe memory reclamation for lock-free readers
+ *
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief Hazard pointer domain used to reclaim nodes read by lock-free readers
+ *
+ * Every thread owns one hazard record with a few slots, records are never freed and are reused
+ * by threads started later. Retired nodes are kept in thread local list and deleted once no
+ * slot points to them, nodes left at thread exit are handed over to the next scanning thread.
+ */
+class hazard_domain {
+  struct thread_state;
+
+public:
+  //! Number of hazard slots per thread, last slot is reserved for copying loads
+  static constexpr unsigned slots = 4;
+
+  //! Node reclaimed by domain
+  struct node {
+    virtual ~node() {}
+    node * NextRetired = nullptr;
+  };
+
+  //! Hazard record of single thread
+  struct alignas(64) record {
+    std::atomic<const node*>  Slots[slots] = {};
+    std::atomic<bool>         Active{false};
+    record                  * Next = nullptr;
+  };
+
+  /**
+   * @brief Protects single node from reclamation while guard exists
+   *
+   * Guards nest up to slots - 1 levels, deeper guards and copying loads take the reserved slot.
+   */
+  class guard {
+  public:
+    explicit guard(bool Reserved = false) : _Owner(local()) {
+      if (!Reserved && _Owner.Depth < slots - 1) _Slot = &_Owner.Record->Slots[_Owner.Depth++];
+      else _Slot = &_Owner.Record->Slots[slots - 1];
+    }
+
+    ~guard() {
+      _Slot->store(nullptr, std::memory_order_release);
+      if (_Slot != &_Owner.Record->Slots[slots - 1]) --_Owner.Depth;
+    }
+
+    //! Check is guard nested beyond available slots
+    bool reserved() const {return _Slot == &_Owner.Record->Slots[slots - 1];}
+
+    //! Publish node as hazardous, caller must validate the node is still reachable afterwards
+    void protect(const node * Node) {_Slot->store(Node, std::memory_order_seq_cst);}
+
+  private:
+    guard(const guard&);
+    guard& operator = (const guard&);
+
+    thread_state              & _Owner;
+    std::atomic<const node*>  * _Slot;
+  };
+
+  //! Retire node unlinked from shared structure, node is deleted once not protected by any thread
+  static void retire(node * Node) {
+    thread_state & Owner = local();
+    Node->NextRetired = Owner.Retired;
+    Owner.Retired = Node;
+    if (++Owner.Count >= std::max<std::size_t>(64, 2 * slots * _Records.load(std::memory_order_relaxed))) scan(Owner);
+  }
+
+private:
+  //! Thread local state: hazard record and retired nodes
+  struct thread_state {
+    thread_state() : Record(claim()) {}
+
+    ~thread_state() {
+      for (std::atomic<const node*> & Slot : Record->Slots) Slot.store(nullptr, std::memory_order_relaxed);
+      scan(*this);
+
+      // - Hand over nodes still protected by other threads
+      if (Retired) {
+        node * Last = Retired;
+        while (Last->NextRetired) Last = Last->NextRetired;
+        Last->NextRetired = _Orphans.load(std::memory_order_relaxed);
+        while (!_Orphans.compare_exchange_weak(Last->NextRetired, Retired, std::memory_order_release, std::memory_order_relaxed)) {}
+      }
+      Record->Active.store(false, std::memory_order_release);
+    }
+
+    record      * Record;
+    node        * Retired = nullptr;
+    std::size_t   Count   = 0;
+    unsigned      Depth   = 0;
+  };
+
+  //! Get state of calling thread
+  static thread_state & local() {
+    thread_local thread_state State;
+    return State;
+  }
+
+  //! Take inactive record or create a new one
+  static record * claim() {
+    for (record * Record = _Head.load(std::memory_order_acquire); Record; Record = Record->Next) {
+      bool Active = false;
+      if (!Record->Active.load(std::memory_order_relaxed) && Record->Active.compare_exchange_strong(Active, true, std::memory_order_acquire)) return Record;
+    }
+    record * Record = new record;
+    Record->Active.store(true, std::memory_order_relaxed);
+    Record->Next = _Head.load(std::memory_order_relaxed);
+    while (!_Head.compare_exchange_weak(Record->Next, Record, std::memory_order_release, std::memory_order_relaxed)) {}
+    _Records.fetch_add(1, std::memory_order_relaxed);
+    return Record;
+  }
+
+  //! Delete retired nodes not protected by any thread
+  static void scan(thread_state & Owner) {
+    // - Adopt nodes left by finished threads
+    if (node * Orphans = _Orphans.exchange(nullptr, std::memory_order_acquire)) {
+      node * Last = Orphans;
+      while (Last->NextRetired) Last = Last->NextRetired;
+      Last->NextRetired = Owner.Retired;
+      Owner.Retired = Orphans;
+    }
+
+    // - Collect protected nodes
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<const node*> Hazards;
+    for (record * Record = _Head.load(std::memory_order_acquire); Record; Record = Record->Next) {
+      for (std::atomic<const node*> & Slot : Record->Slots) {
+        if (const node * Node = Slot.load(std::memory_order_seq_cst)) Hazards.push_back(Node);
+      }
+    }
+    std::sort(Hazards.begin(), Hazards.end());
+
+    // - Delete the rest
+    node * Kept = nullptr;
+    Owner.Count = 0;
+    for (node * Node = Owner.Retired; Node;) {
+      node * Next = Node->NextRetired;
+      if (std::binary_search(Hazards.begin(), Hazards.end(), Node)) {
+        Node->NextRetired = Kept;
+        Kept = Node;
+        ++Owner.Count;
+      } else delete Node;
+      Node = Next;
+    }
+    Owner.Retired = Kept;
+  }
+
+  //! List of all hazard records
+  static inline std::atomic<record*>      _Head{nullptr};
+
+  //! Number of hazard records
+  static inline std::atomic<std::size_t>  _Records{0};
+
+  //! Nodes retired by finished threads
+  static inline std::atomic<node*>        _Orphans{nullptr};
+};
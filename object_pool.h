@@ -0,0 +1,300 @@
+/*
+ * OBJECT_POOL is slab allocator for objects of single size
+ *
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Pool of fixed size memory blocks carved from slabs
+ *
+ * Every thread keeps own free list per pool, allocation and release take no lock while the
+ * list has blocks. Lists exchange blocks with the shared pool list in batches, slabs are freed
+ * only with the pool. Blocks released by other thread go to free list of the releasing thread.
+ * Pool whose owner is gone is given up by retire(): no more blocks are allocated from it and it
+ * deletes itself once the last block is released. Ids of deleted pools are reused, so per-thread
+ * free list tables stay as large as the number of pools alive at once.
+ */
+class object_pool {
+public:
+  //! Pool statistics
+  struct statistics {
+    //! Blocks handed out by allocate()
+    std::size_t Allocated = 0;
+    //! Blocks returned by deallocate()
+    std::size_t Released  = 0;
+    //! Slabs allocated
+    std::size_t Slabs     = 0;
+    //! Blocks in all slabs
+    std::size_t Capacity  = 0;
+
+    //! Blocks in use
+    std::size_t live() const {return Allocated - Released;}
+  };
+
+  //! Number of blocks moved between thread free list and shared list at once
+  static constexpr std::size_t batch_size = 32;
+
+  //! Preferred slab size in bytes, block larger than that gets slab of its own
+  static constexpr std::size_t slab_size = 16384;
+
+  object_pool(std::size_t Size, std::size_t Alignment)
+    : _Id(claim()),
+      _Alignment(std::max(Alignment, alignof(node))),
+      _Stride((std::max(Size, sizeof(node)) + _Alignment - 1) / _Alignment * _Alignment),
+      _PerSlab(std::max<std::size_t>(1, slab_size / _Stride)) {}
+
+  //! Destructor, slabs are freed together with all blocks in them
+  ~object_pool() {
+    std::lock_guard<std::mutex> Lock(_Registry);
+    destroy();
+  }
+
+  //! Get block size
+  std::size_t size() const {return _Stride;}
+
+  //! Get block
+  void * allocate() {
+    cache & Cache = local();
+    if (!Cache.Head) refill(Cache);
+    node * Node = Cache.Head;
+    Cache.Head = Node->Next;
+    --Cache.Count;
+    bump(Cache.Allocated);
+    return Node;
+  }
+
+  //! Return block to free list of calling thread
+  void deallocate(void * Block) {
+    cache & Cache = local();
+    node * Node = static_cast<node*>(Block);
+    Node->Next = Cache.Head;
+    Cache.Head = Node;
+    if (++Cache.Count >= 2 * batch_size) flush(Cache, batch_size);
+
+    // - Release is counted last, retired pool may be deleted by other thread as soon as it is seen.
+    // - Fence pairs with the one in retire(): either this release sees the retirement or retire() sees the release
+    Cache.Released.store(Cache.Released.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Cache.Retired.load(std::memory_order_relaxed)) sweep();
+  }
+
+  //! Give up pool, no block may be allocated afterwards, pool is deleted once all blocks are released
+  void retire() {
+    {
+      std::lock_guard<std::mutex> Lock(_Registry);
+      _Retired = true;
+      for (cache * Cache : _Caches) Cache->Retired.store(true, std::memory_order_relaxed);
+      _Orphans.push_back(this);
+    }
+    // - Retirement is visible before release counts are read, see deallocate()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    sweep();
+  }
+
+  //! Get pool statistics
+  statistics stats() const {
+    std::lock_guard<std::mutex> Lock(_Registry);
+    statistics Result = _Finished;
+    for (const cache * Cache : _Caches) {
+      Result.Allocated += Cache->Allocated.load(std::memory_order_relaxed);
+      Result.Released  += Cache->Released.load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> SlabLock(_Mutex);
+    Result.Slabs    = _Slabs.size();
+    Result.Capacity = _Slabs.size() * _PerSlab;
+    return Result;
+  }
+
+private:
+  object_pool(const object_pool&);
+  object_pool& operator = (const object_pool&);
+
+  //! Free block
+  struct node {
+    node * Next;
+  };
+
+  //! Free list of single thread, counters are written by owning thread only
+  struct cache {
+    //! Pool of the list, null once the pool is deleted
+    std::atomic<object_pool*>   Pool{nullptr};
+    node                      * Head  = nullptr;
+    std::size_t                 Count = 0;
+    std::atomic<std::size_t>    Allocated{0};
+    std::atomic<std::size_t>    Released{0};
+    //! Pool is retired, releases check for its deletion
+    std::atomic<bool>           Retired{false};
+  };
+
+  //! Free lists of calling thread indexed by pool id
+  struct thread_caches {
+    ~thread_caches() {
+      std::lock_guard<std::mutex> Lock(_Registry);
+      for (cache * Cache : Caches) {
+        if (!Cache) continue;
+        if (object_pool * Pool = Cache->Pool.load(std::memory_order_relaxed)) Pool->detach(*Cache);
+        delete Cache;
+      }
+    }
+
+    std::vector<cache*> Caches;
+  };
+
+  //! Increment counter owned by calling thread
+  static void bump(std::atomic<std::size_t> & Counter) {
+    Counter.store(Counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  //! Get free list of calling thread
+  cache & local() {
+    thread_local thread_caches Thread;
+    if (_Id < Thread.Caches.size()) {
+      cache * Cache = Thread.Caches[_Id];
+      if (Cache && Cache->Pool.load(std::memory_order_relaxed) == this) return *Cache;
+    }
+
+    // - First use of pool on this thread, list left by deleted pool with the same id is dropped with its blocks
+    if (_Id >= Thread.Caches.size()) Thread.Caches.resize(_Id + 1, nullptr);
+    cache * Cache = new cache;
+    Cache->Pool.store(this, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> Lock(_Registry);
+    Cache->Retired.store(_Retired, std::memory_order_relaxed);
+    _Caches.push_back(Cache);
+    delete Thread.Caches[_Id];
+    Thread.Caches[_Id] = Cache;
+    return *Cache;
+  }
+
+  //! Take batch of blocks from shared list, allocate new slab if it is empty
+  void refill(cache & Cache) {
+    std::lock_guard<std::mutex> Lock(_Mutex);
+    if (!_Free) {
+      std::uint8_t * Slab = static_cast<std::uint8_t*>(::operator new(_Stride * _PerSlab, std::align_val_t(_Alignment)));
+      _Slabs.push_back(Slab);
+      for (std::size_t Index = _PerSlab; Index--;) {
+        node * Node = reinterpret_cast<node*>(Slab + Index * _Stride);
+        Node->Next = _Free;
+        _Free = Node;
+      }
+    }
+    for (std::size_t Index = 0; Index < batch_size && _Free; ++Index) {
+      node * Node = _Free;
+      _Free = Node->Next;
+      Node->Next = Cache.Head;
+      Cache.Head = Node;
+      ++Cache.Count;
+    }
+  }
+
+  //! Move given number of blocks from thread free list to shared list
+  void flush(cache & Cache, std::size_t Count) {
+    std::lock_guard<std::mutex> Lock(_Mutex);
+    for (; Count && Cache.Head; --Count) {
+      node * Node = Cache.Head;
+      Cache.Head = Node->Next;
+      --Cache.Count;
+      Node->Next = _Free;
+      _Free = Node;
+    }
+  }
+
+  //! Count blocks not yet released, called under registry mutex
+  std::size_t live() const {
+    std::size_t Allocated = _Finished.Allocated, Released = _Finished.Released;
+    for (const cache * Cache : _Caches) {
+      Allocated += Cache->Allocated.load(std::memory_order_relaxed);
+      Released  += Cache->Released.load(std::memory_order_acquire);
+    }
+    return Allocated - Released;
+  }
+
+  //! Take id of deleted pool or a new one, retired pools without blocks are deleted first
+  static std::size_t claim() {
+    sweep();
+    std::lock_guard<std::mutex> Lock(_Registry);
+    if (_FreeIds.empty()) return _Ids++;
+    std::size_t Id = _FreeIds.back();
+    _FreeIds.pop_back();
+    return Id;
+  }
+
+  //! Delete retired pools whose blocks are all released
+  static void sweep() {
+    std::vector<object_pool*> Released;
+    {
+      std::lock_guard<std::mutex> Lock(_Registry);
+      for (std::size_t Index = 0; Index < _Orphans.size();) {
+        if (_Orphans[Index]->live()) {
+          ++Index;
+          continue;
+        }
+        // - Torn down under the mutex, so exiting thread never detaches free list from deleted pool
+        _Orphans[Index]->destroy();
+        Released.push_back(_Orphans[Index]);
+        _Orphans[Index] = _Orphans.back();
+        _Orphans.pop_back();
+      }
+    }
+    for (object_pool * Pool : Released) delete Pool;
+  }
+
+  //! Detach free lists and free slabs, called under registry mutex, pool is unusable afterwards
+  void destroy() {
+    if (_Destroyed) return;
+    for (cache * Cache : _Caches) Cache->Pool.store(nullptr, std::memory_order_relaxed);
+    for (void * Slab : _Slabs) ::operator delete(Slab, std::align_val_t(_Alignment));
+    _Caches.clear();
+    _Slabs.clear();
+    _FreeIds.push_back(_Id);
+    _Destroyed = true;
+  }
+
+  //! Release free list of finished thread, called under registry mutex
+  void detach(cache & Cache) {
+    flush(Cache, Cache.Count);
+    _Finished.Allocated += Cache.Allocated.load(std::memory_order_relaxed);
+    _Finished.Released  += Cache.Released.load(std::memory_order_relaxed);
+    _Caches.erase(std::find(_Caches.begin(), _Caches.end(), &Cache));
+  }
+
+  //! Pool id, index of thread free list
+  const std::size_t         _Id;
+
+  //! Block alignment and size
+  const std::size_t         _Alignment;
+  const std::size_t         _Stride;
+
+  //! Blocks per slab
+  const std::size_t         _PerSlab;
+
+  //! Shared free list and slabs
+  mutable std::mutex        _Mutex;
+  node                    * _Free = nullptr;
+  std::vector<void*>        _Slabs;
+
+  //! Free lists of running threads and counters of finished ones, guarded by registry mutex
+  std::vector<cache*>       _Caches;
+  statistics                _Finished;
+
+  //! Pool was given up by its owner, pool was torn down; guarded by registry mutex
+  bool                      _Retired = false;
+  bool                      _Destroyed = false;
+
+  //! Next new pool id and ids of deleted pools, guarded by registry mutex
+  static inline std::size_t               _Ids = 0;
+  static inline std::vector<std::size_t>  _FreeIds;
+
+  //! Retired pools with blocks still in use, guarded by registry mutex
+  static inline std::vector<object_pool*> _Orphans;
+
+  //! Mutex guarding thread free list registration, pool ids and retired pools
+  static inline std::mutex                _Registry;
+};
@@ -0,0 +1,128 @@
+/*
+ * PREPARED_DYNAMIC is dynamic value with cached parsed representation
+ *
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include "dynamic.h"
+
+/**
+ * @brief Dynamic value caching results of casts from String
+ *
+ * String value is parsed on the first cast to integer, float, double or bool, result (or failure)
+ * is cached next to the payload and reused by following casts until a new value is assigned.
+ * Casts give the same results and throw the same errors as casts of plain dynamic. Cache is
+ * filled with atomics, so concurrent casts of the same value from many threads are safe.
+ */
+class prepared_dynamic {
+public:
+  prepared_dynamic() : _State(0) {}
+  prepared_dynamic(const prepared_dynamic & Value) : _Value(Value._Value), _State(0) {}
+  prepared_dynamic(prepared_dynamic && Value) noexcept : _Value(std::move(Value._Value)), _State(0) {Value.reset();}
+
+  //! Create from any value dynamic can be created from
+  template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, prepared_dynamic>::value>::type>
+  prepared_dynamic(T && Value) : _Value(std::forward<T>(Value)), _State(0) {}
+
+  void operator = (const prepared_dynamic & Value) {_Value = Value._Value; reset();}
+  void operator = (prepared_dynamic && Value)      {_Value = std::move(Value._Value); reset(); Value.reset();}
+
+  //! Assign any value dynamic can be assigned from, cached results are dropped
+  template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, prepared_dynamic>::value>::type>
+  void operator = (T && Value) {
+    _Value = std::forward<T>(Value);
+    reset();
+  }
+
+  //! Get stored value
+  const dynamic & value() const {return _Value;}
+  operator const dynamic & () const {return _Value;}
+
+  //! Cast to specified type, casts of String to numbers and bool are cached
+  template <typename T>
+  T cast() const {
+    if (_Value.type() != dynamic::Type::String) return _Value.cast<T>();
+    if constexpr (std::is_same<T, bool>::value) {
+      return load<Bool>(_Bool, [this] {return _Value.cast<bool>();});
+    } else if constexpr (std::is_same<T, float>::value) {
+      return load<Float>(_Float, [this] {return _Value.cast<float>();});
+    } else if constexpr (std::is_floating_point<T>::value) {
+      return static_cast<T>(load<Double>(_Double, [this] {return _Value.cast<double>();}));
+    } else if constexpr (std::is_signed<T>::value) {
+      // - Text parsed once as the widest integer of the same signedness, narrower widths are range checked
+      std::int64_t Result = load<Signed>(_Signed, [this] {return _Value.cast<std::int64_t>();});
+      if (Result < std::numeric_limits<T>::min() || Result > std::numeric_limits<T>::max()) throw std::bad_cast();
+      return static_cast<T>(Result);
+    } else if constexpr (std::is_integral<T>::value) {
+      std::uint64_t Result = load<Unsigned>(_Unsigned, [this] {return _Value.cast<std::uint64_t>();});
+      if (Result > std::numeric_limits<T>::max()) throw std::bad_cast();
+      return static_cast<T>(Result);
+    } else {
+      return _Value.cast<T>();
+    }
+  }
+
+  operator std::int8_t() const    {return cast<std::int8_t>();}
+  operator std::int16_t() const   {return cast<std::int16_t>();}
+  operator std::int32_t() const   {return cast<std::int32_t>();}
+  operator std::int64_t() const   {return cast<std::int64_t>();}
+
+  operator std::uint8_t() const   {return cast<std::uint8_t>();}
+  operator std::uint16_t() const  {return cast<std::uint16_t>();}
+  operator std::uint32_t() const  {return cast<std::uint32_t>();}
+  operator std::uint64_t() const  {return cast<std::uint64_t>();}
+
+  operator bool() const   {return cast<bool>();}
+  operator float() const  {return cast<float>();}
+  operator double() const {return cast<double>();}
+  operator std::string() const {return _Value;}
+
+private:
+  //! Cached representations, two state bits each: parsed and valid
+  enum : unsigned {Signed = 0, Unsigned = 2, Double = 4, Float = 6, Bool = 8};
+
+  //! Get cached result of given representation, parse it on first use
+  template <unsigned Shift, typename T, typename Parser>
+  T load(std::atomic<T> & Cache, Parser Parse) const {
+    unsigned State = _State.load(std::memory_order_acquire) >> Shift;
+    if (State & 1) {
+      if (State & 2) return Cache.load(std::memory_order_relaxed);
+      throw std::bad_cast();
+    }
+    // - Concurrent first casts may parse twice, they store the same result
+    try {
+      T Result = Parse();
+      Cache.store(Result, std::memory_order_relaxed);
+      _State.fetch_or(3u << Shift, std::memory_order_release);
+      return Result;
+    } catch (const std::bad_cast &) {
+      _State.fetch_or(1u << Shift, std::memory_order_release);
+      throw;
+    }
+  }
+
+  //! Drop cached results
+  void reset() {
+    _State.store(0, std::memory_order_relaxed);
+  }
+
+  //! Stored value
+  dynamic                             _Value;
+
+  //! Cached parse results
+  mutable std::atomic<std::int64_t>   _Signed{0};
+  mutable std::atomic<std::uint64_t>  _Unsigned{0};
+  mutable std::atomic<double>         _Double{0};
+  mutable std::atomic<float>          _Float{0};
+  mutable std::atomic<bool>           _Bool{false};
+
+  //! Parsed and valid bits of cached results
+  mutable std::atomic<unsigned>       _State;
+};
@@ -0,0 +1,36 @@
+#include "tests/test.h"
+#include "dynamic_array.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST(extremum_keeps_kind_of_column) {
+  dynamic_array Bytes(std::vector<dynamic>{std::int8_t(5), std::int8_t(-7), std::int8_t(9)});
+  CHECK(Bytes.min().kind() == dynamic::Kind::Int8 && Bytes.min() == -7);
+  CHECK(Bytes.max().kind() == dynamic::Kind::Int8 && Bytes.max() == 9);
+
+  dynamic_array Floats(std::vector<dynamic>{1.5f, -2.25f, 0.5f});
+  CHECK(Floats.min().kind() == dynamic::Kind::Float32 && Floats.min() == -2.25f);
+  CHECK(Floats.max().kind() == dynamic::Kind::Float32 && Floats.max() == 1.5f);
+
+  dynamic_array Unsigned(std::vector<dynamic>{std::uint16_t(3), std::uint64_t(70000), std::uint8_t(1)});
+  CHECK(Unsigned.max().kind() == dynamic::Kind::UInt64 && Unsigned.max() == 70000u);
+  CHECK(Unsigned.min().kind() == dynamic::Kind::UInt8 && Unsigned.min() == 1u);
+}
+
+TEST(extremum_of_mixed_column) {
+  dynamic_array Mixed(std::vector<dynamic>{std::int32_t(4), dynamic(), 2.5, std::uint8_t(8)});
+  CHECK(Mixed.min().kind() == dynamic::Kind::Float64 && Mixed.min() == 2.5);
+  CHECK(Mixed.max().kind() == dynamic::Kind::UInt8 && Mixed.max() == 8u);
+  CHECK(dynamic_array().min().kind() == dynamic::Kind::Undefined);
+}
+
+TEST(text_rows_round_trip) {
+  dynamic_array Text(std::vector<dynamic>{"alpha", std::string(70000, 'x'), "b"});
+  CHECK(Text.get(0) == "alpha");
+  CHECK(Text.get(1).size() == 70000);
+  CHECK(Text.get(2) == "b" && Text.kind(2) == dynamic::Kind::String);
+}
+
+TEST_MAIN()
@@ -0,0 +1,60 @@
+#include "tests/test.h"
+#include "dynamic_batch.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST(errors_mark_values_out_of_range) {
+  std::vector<dynamic> Values = {1.5, std::nan(""), 1e30, -HUGE_VAL, -2.0, std::int64_t(1) << 40, std::uint64_t(UINT64_MAX), "12", "x", dynamic()};
+  std::vector<std::int32_t> Output;
+  dynamic_batch::pool Pool(1);
+  dynamic_batch::bitmask Errors = dynamic_batch::cast(Values, Output, Pool);
+  const bool Expected[] = {false, true, true, true, false, true, true, false, true, true};
+  for (std::size_t Index = 0; Index < Values.size(); ++Index) {
+    CHECK(Errors.test(Index) == Expected[Index]);
+    if (Expected[Index]) CHECK(Output[Index] == 0);
+  }
+  CHECK(Output[0] == 1 && Output[4] == -2 && Output[7] == 12);
+
+  std::vector<std::uint8_t> Bytes;
+  Errors = dynamic_batch::cast(std::vector<dynamic>{std::int16_t(255), std::int16_t(256), std::int8_t(-1)}, Bytes, Pool);
+  CHECK(!Errors.test(0) && Errors.test(1) && Errors.test(2) && Bytes[0] == 255);
+}
+
+TEST(runs_of_mixed_kinds_across_tasks) {
+  // - Runs of every kind are longer and shorter than grain and cross task boundaries
+  std::vector<dynamic> Values;
+  for (std::size_t Index = 0; Index < 3 * dynamic_batch::grain + 17; ++Index) {
+    switch (Index / 1000 % 5) {
+      case 0:  Values.emplace_back(static_cast<std::int8_t>(Index % 100)); break;
+      case 1:  Values.emplace_back(static_cast<std::uint32_t>(Index)); break;
+      case 2:  Values.emplace_back(static_cast<float>(Index) + 0.25f); break;
+      case 3:  Values.emplace_back(std::to_string(Index)); break;
+      default: Values.emplace_back(Index % 2 ? dynamic(static_cast<double>(Index)) : dynamic(static_cast<std::int64_t>(Index)));
+    }
+  }
+  dynamic_batch::pool Pool(4);
+  std::vector<double> Numbers;
+  std::vector<std::string> Texts;
+  CHECK(dynamic_batch::cast(Values, Numbers, Pool).count() == 0);
+  CHECK(dynamic_batch::cast(Values, Texts, Pool).count() == 0);
+  for (std::size_t Index = 0; Index < Values.size(); ++Index) {
+    CHECK(Numbers[Index] == Values[Index].cast<double>());
+    CHECK(Texts[Index] == Values[Index].cast<std::string>());
+  }
+}
+
+TEST(assign_native_values) {
+  std::vector<std::int16_t> Input(10000);
+  for (std::size_t Index = 0; Index < Input.size(); ++Index) Input[Index] = static_cast<std::int16_t>(Index * 3);
+  std::vector<dynamic> Output;
+  dynamic_batch::pool Pool(3);
+  dynamic_batch::assign(Input, Output, Pool);
+  CHECK(Output.size() == Input.size());
+  bool Same = true;
+  for (std::size_t Index = 0; Index < Input.size(); ++Index) Same = Same && Output[Index].kind() == dynamic::Kind::Int16 && Output[Index] == Input[Index];
+  CHECK(Same);
+}
+
+TEST_MAIN()
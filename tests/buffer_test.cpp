@@ -0,0 +1,94 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include "dynamic_json.h"
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+namespace {
+  //! Fill arena storage after arena is gone, reads of arena memory see garbage
+  void poison(std::byte * Storage, std::size_t Size) {
+    std::memset(Storage, 0xA5, Size);
+  }
+
+  //! Build Object with large String and nested Array, all storage from given resource
+  dynamic build(std::pmr::memory_resource * Resource) {
+    dynamic Result = dynamic::object(Resource);
+    Result["text"] = std::string(2048, 't');
+    Result["list"] = dynamic::array(Resource);
+    for (int Index = 0; Index < 8; ++Index) Result["list"].push_back(std::string(1500, static_cast<char>('a' + Index)));
+    return Result;
+  }
+
+  //! Check content produced by build()
+  bool built(const dynamic & Value) {
+    if (Value["text"].as_string_view() != std::string(2048, 't')) return false;
+    if (Value["list"].length() != 8) return false;
+    for (int Index = 0; Index < 8; ++Index)
+      if (Value["list"][Index].as_string_view() != std::string(1500, static_cast<char>('a' + Index))) return false;
+    return true;
+  }
+}
+
+TEST(copy_outlives_arena) {
+  alignas(std::max_align_t) static std::byte Storage[1 << 16];
+  dynamic Copy;
+  {
+    std::pmr::monotonic_buffer_resource Arena(Storage, sizeof(Storage), std::pmr::null_memory_resource());
+    dynamic Original = build(&Arena);
+    Copy = Original;
+    CHECK(!Copy.value().same_block(Original.value()));
+    CHECK(!Copy["text"].value().same_block(Original["text"].value()));
+  }
+  poison(Storage, sizeof(Storage));
+  CHECK(built(Copy));
+}
+
+TEST(move_outlives_arena) {
+  alignas(std::max_align_t) static std::byte Storage[1 << 16];
+  dynamic Target;
+  {
+    std::pmr::monotonic_buffer_resource Arena(Storage, sizeof(Storage), std::pmr::null_memory_resource());
+    dynamic Original = build(&Arena);
+    Target = std::move(Original);
+  }
+  poison(Storage, sizeof(Storage));
+  CHECK(built(Target));
+}
+
+TEST(copy_shares_within_resource) {
+  std::pmr::monotonic_buffer_resource Arena;
+  dynamic Original = build(&Arena);
+  dynamic Copy(&Arena);
+  Copy = Original;
+  CHECK(Copy.value().same_block(Original.value()));
+  dynamic Default = build(nullptr);
+  dynamic DefaultCopy = Default;
+  CHECK(DefaultCopy.value().same_block(Default.value()));
+}
+
+TEST(interned_copy_is_shared_across_resources) {
+  std::pmr::monotonic_buffer_resource Arena;
+  dynamic Interned = dynamic::intern("interned across resources");
+  dynamic Copy(&Arena);
+  Copy = Interned;
+  CHECK(Copy.isInterned());
+  CHECK(Copy.value().same_block(Interned.value()));
+}
+
+TEST(value_copied_out_of_json_document) {
+  std::string Text = "{\"name\": \"" + std::string(2000, 'n') + "\", \"items\": [1, \"two\", {\"three\": 3}]}";
+  dynamic Copy;
+  {
+    dynamic_json::document Document(Text);
+    Copy = Document.root();
+  }
+  CHECK(Copy["name"].as_string_view() == std::string(2000, 'n'));
+  CHECK(static_cast<int>(Copy["items"][0]) == 1);
+  CHECK(static_cast<std::string>(Copy["items"][1]) == "two");
+  CHECK(static_cast<int>(Copy["items"][2]["three"]) == 3);
+}
+
+TEST_MAIN()
@@ -0,0 +1,76 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include "concurrent_dynamic.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+  //! Size of strings kept in heap payload
+  constexpr std::size_t large_size = 2000;
+
+  //! Value stored by writer in given step, even steps fit inline, odd steps go to heap
+  dynamic step(std::uint64_t Step) {
+    if (Step % 2 == 0) return dynamic(static_cast<std::int64_t>(Step));
+    return dynamic(std::string(large_size, static_cast<char>('a' + Step % 26)));
+  }
+
+  //! Check that value is one the writer has stored in whole
+  bool consistent(const dynamic & Value) {
+    if (Value.kind() == dynamic::Kind::Int64) return static_cast<std::int64_t>(Value) % 2 == 0;
+    if (Value.kind() != dynamic::Kind::String) return false;
+    std::string_view Text = Value.as_string_view();
+    return Text.size() == large_size && Text.find_first_not_of(Text[0]) == std::string_view::npos;
+  }
+}
+
+TEST(round_trip) {
+  concurrent_dynamic Cell;
+  CHECK(Cell.load().kind() == dynamic::Kind::Undefined);
+  dynamic Values[] = {dynamic(42), dynamic(2.5), dynamic("short"), dynamic(std::string(large_size, 'x'))};
+  for (const dynamic & Value : Values) {
+    Cell.store(Value);
+    CHECK(Cell.load() == Value);
+    CHECK(Cell.read([&Value](const dynamic & Stored) {return Stored == Value;}));
+  }
+  dynamic List;
+  List.push_back(1);
+  List.push_back("two");
+  Cell = List;
+  CHECK(Cell.load() == List);
+  CHECK(Cell.version() == 5);
+}
+
+TEST(writer_and_reader_threads) {
+  const std::uint64_t Steps = 20000;
+  concurrent_dynamic Cell(step(0));
+  std::atomic<bool> Done{false};
+  std::atomic<std::uint64_t> Torn{0}, Inline{0}, Heap{0};
+
+  std::thread Reader([&] {
+    while (!Done.load(std::memory_order_acquire)) {
+      dynamic Value = Cell.load();
+      if (!consistent(Value)) Torn.fetch_add(1, std::memory_order_relaxed);
+      (Value.kind() == dynamic::Kind::String ? Heap : Inline).fetch_add(1, std::memory_order_relaxed);
+      if (!Cell.read(consistent)) Torn.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  std::thread Writer([&] {
+    for (std::uint64_t Step = 1; Step <= Steps; ++Step) {
+      Cell.store(step(Step));
+      if (Step % 64 == 0) std::this_thread::yield();
+    }
+    Done.store(true, std::memory_order_release);
+  });
+  Writer.join();
+  Reader.join();
+
+  CHECK(Torn.load() == 0);
+  CHECK(Inline.load() + Heap.load() > 0);
+  CHECK(Cell.version() == Steps + 1);
+  CHECK(Cell.load() == step(Steps));
+}
+
+TEST_MAIN()
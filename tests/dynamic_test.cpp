@@ -0,0 +1,138 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+TEST(conversion_between_numbers_and_strings) {
+  dynamic Value = 10;
+  CHECK(static_cast<double>(Value) == 10.0);
+  CHECK(static_cast<std::string>(Value) == "10");
+  Value = "2.5";
+  CHECK(static_cast<double>(Value) == 2.5);
+  CHECK(Value.kind() == dynamic::Kind::String);
+}
+
+TEST(try_cast_reports_failure_without_exception) {
+  dynamic Value = "text";
+  CHECK(!Value.try_cast<int>());
+  CHECK_THROWS(std::bad_cast, static_cast<int>(Value));
+}
+
+TEST(string_to_number_needs_whole_text_in_range) {
+  CHECK(static_cast<std::int8_t>(dynamic(" 127 ")) == 127);
+  CHECK(static_cast<std::int8_t>(dynamic("-128")) == -128);
+  CHECK(static_cast<std::uint64_t>(dynamic("+18446744073709551615")) == UINT64_MAX);
+  CHECK(static_cast<double>(dynamic("3.5\n")) == 3.5);
+  CHECK_THROWS(std::bad_cast, static_cast<std::int8_t>(dynamic("300")));
+  CHECK_THROWS(std::bad_cast, static_cast<std::uint8_t>(dynamic("-1")));
+  CHECK_THROWS(std::bad_cast, static_cast<std::int32_t>(dynamic("12abc")));
+  CHECK_THROWS(std::bad_cast, static_cast<std::int32_t>(dynamic("3.5")));
+  CHECK_THROWS(std::bad_cast, static_cast<std::int32_t>(dynamic("+-5")));
+  CHECK(!dynamic("70000").try_cast<std::int16_t>());
+  CHECK(dynamic("70000").try_cast<std::int32_t>() == 70000);
+}
+
+TEST(try_cast_reports_values_not_representable) {
+  CHECK(!dynamic(1e20).try_cast<int>());
+  CHECK(!dynamic(std::nan("")).try_cast<std::int64_t>());
+  CHECK(!dynamic(-HUGE_VAL).try_cast<std::int32_t>());
+  CHECK(!dynamic(-1.0).try_cast<unsigned>());
+  CHECK(!dynamic(9223372036854775808.0).try_cast<std::int64_t>());
+  CHECK(dynamic(-9223372036854775808.0).try_cast<std::int64_t>() == INT64_MIN);
+  CHECK(dynamic(18446744073709549568.0).try_cast<std::uint64_t>() == 18446744073709549568u);
+  CHECK(dynamic(-0.75).try_cast<std::uint8_t>() == 0);
+  CHECK(dynamic(255.9f).try_cast<std::uint8_t>() == 255);
+  CHECK(!dynamic(std::int64_t(300)).try_cast<std::int8_t>());
+  CHECK(!dynamic(std::int8_t(-1)).try_cast<std::uint64_t>());
+  CHECK(!dynamic(std::uint64_t(UINT64_MAX)).try_cast<std::int64_t>());
+  CHECK(dynamic(std::int64_t(-128)).try_cast<std::int8_t>() == -128);
+  CHECK(dynamic(std::uint32_t(65535)).try_cast<std::uint16_t>() == 65535);
+  CHECK(dynamic(1e300).try_cast<float>().has_value());
+  CHECK(dynamic(std::nan("")).try_cast<bool>() == true);
+  CHECK_THROWS(std::bad_cast, static_cast<std::int8_t>(dynamic(std::int64_t(300))));
+}
+
+TEST(get_if_matches_exact_type_and_width) {
+  dynamic Value = std::int32_t(7);
+  CHECK(Value.get_if<std::int32_t>() && *Value.get_if<std::int32_t>() == 7);
+  CHECK(!Value.get_if<std::int64_t>());
+  CHECK(!Value.get_if<std::uint32_t>());
+  CHECK(!Value.get_if<float>());
+  *Value.get_if<std::int32_t>() = 9;
+  CHECK(Value == 9);
+  dynamic List;
+  List.push_back(1);
+  CHECK(List.get_if<dynamic::array_type>() && List.get_if<dynamic::array_type>()->size() == 1);
+  CHECK(!List.get_if<dynamic::object_type>());
+  CHECK(!dynamic("1").get_if<std::int32_t>());
+}
+
+TEST(visit_passes_native_type) {
+  auto describe = [](const auto & Stored) -> std::string {
+    typedef typename std::decay<decltype(Stored)>::type T;
+    if constexpr (std::is_same<T, std::nullptr_t>::value) return "undefined";
+    else if constexpr (std::is_same<T, std::string_view>::value) return "text:" + std::string(Stored);
+    else if constexpr (std::is_same<T, std::uint16_t>::value) return "uint16:" + std::to_string(Stored);
+    else if constexpr (std::is_same<T, float>::value) return "float32";
+    else if constexpr (std::is_same<T, dynamic::array_type>::value) return "array:" + std::to_string(Stored.size());
+    else return "other";
+  };
+  CHECK(dynamic().visit(describe) == "undefined");
+  CHECK(dynamic("ab").visit(describe) == "text:ab");
+  CHECK(dynamic(std::uint16_t(40000)).visit(describe) == "uint16:40000");
+  CHECK(dynamic(1.5f).visit(describe) == "float32");
+  CHECK(dynamic(1.5).visit(describe) == "other");
+  dynamic List;
+  List.push_back(1);
+  List.push_back(2);
+  CHECK(List.visit(describe) == "array:2");
+}
+
+TEST(array_and_object_copies_are_independent) {
+  dynamic Item;
+  Item["name"] = "item";
+  Item["tags"].push_back(1);
+  Item["tags"].push_back("two");
+  dynamic Copy = Item;
+  Copy["tags"].push_back(3);
+  CHECK(Item["tags"].length() == 2);
+  CHECK(Copy["tags"].length() == 3);
+  CHECK(static_cast<std::string>(Copy["name"]) == "item");
+}
+
+TEST(large_string_copy_shares_until_modified) {
+  dynamic Value = std::string(4096, 'x');
+  dynamic Copy = Value;
+  CHECK(Copy.value().is_shared());
+  CHECK(std::as_const(Copy).data() == std::as_const(Value).data());
+  Copy.data()[0] = 'y';
+  CHECK(Value.as_string_view()[0] == 'x');
+  CHECK(Copy.as_string_view()[0] == 'y');
+}
+
+TEST(keys_hash_and_order_by_total_order) {
+  std::unordered_map<dynamic, int, dynamic::hasher, dynamic::key_equal> Hashed;
+  Hashed[dynamic(std::int8_t(5))] = 1;
+  Hashed[dynamic(std::uint64_t(5))] += 1;
+  Hashed[dynamic(5.0)] += 1;
+  Hashed[dynamic("5")] = 10;
+  Hashed[dynamic(std::nan(""))] = 20;
+  CHECK(Hashed.size() == 3);
+  CHECK(Hashed[dynamic(std::int64_t(5))] == 3);
+  CHECK(Hashed.count(dynamic(std::nan(""))) == 1);
+
+  std::map<dynamic, int, dynamic::key_less> Sorted = {{dynamic("b"), 0}, {dynamic(2.5), 0}, {dynamic(-1), 0}, {dynamic(), 0}};
+  std::vector<dynamic> Keys;
+  for (const auto & Entry : Sorted) Keys.push_back(Entry.first);
+  CHECK(Keys.size() == 4 && Keys[0].kind() == dynamic::Kind::Undefined);
+  CHECK(Keys[1] == -1 && Keys[2] == 2.5 && Keys[3] == "b");
+}
+
+TEST_MAIN()
@@ -0,0 +1,168 @@
+#include "tests/test.h"
+#include "dynamic_factory.h"
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace {
+  struct shape {
+    virtual ~shape() {}
+    virtual int sides() const = 0;
+  };
+
+  struct triangle : shape {
+    int sides() const override {return 3;}
+  };
+
+  struct polygon : shape {
+    polygon() : count(0) {}
+    explicit polygon(int sides) : count(sides) {}
+    int sides() const override {return count;}
+    int count;
+  };
+
+  //! Shape taking its name from C string
+  struct named : shape {
+    explicit named(const char* name) : count(static_cast<int>(std::strlen(name))) {}
+    int sides() const override {return count;}
+    int count;
+  };
+
+  typedef dynamic_factory<shape> factory;
+
+  constexpr auto registry = factory::MakeStaticRegistry(
+    factory::StaticClass<triangle>("triangle"),
+    factory::StaticClass<polygon, int>("polygon"));
+
+  //! Factory used by constructors of nested shapes
+  factory * Nested = nullptr;
+
+  //! Shape creating pooled child of given depth through the factory in its constructor
+  struct nested : shape {
+    explicit nested(int depth) : child(depth > 0 ? Nested->CreatePooledInstance("nested", depth - 1) : factory::InstancePtr()) {
+      if (depth) return;
+      // - Innermost constructor unregisters the class and retires snapshots while outer constructors still run
+      Nested->UnregisterClass("nested");
+      for (int index = 0; index < 128; ++index) {
+        Nested->RegisterClass<triangle>("churn");
+        Nested->UnregisterClass("churn");
+      }
+    }
+    int sides() const override {return child ? child->sides() + 1 : 0;}
+    factory::InstancePtr child;
+  };
+
+  //! Shape unregistering own class while it is constructed
+  struct transient : shape {
+    transient() {
+      Nested->UnregisterClass("transient");
+      for (int index = 0; index < 64; ++index) Nested->RegisterClass<triangle>("filler" + std::to_string(index));
+      Nested->UnregisterAll();
+    }
+    int sides() const override {return 1;}
+  };
+}
+
+TEST(runtime_registration) {
+  factory Factory;
+  CHECK(Factory.RegisterClass<triangle>("triangle"));
+  CHECK(!Factory.RegisterClass<triangle>("triangle"));
+  CHECK(Factory.RegisterClass<polygon, int>("polygon"));
+  std::unique_ptr<shape> Triangle(Factory.CreateInstance("triangle"));
+  std::unique_ptr<shape> Polygon(Factory.CreateInstance("polygon", 6));
+  CHECK(Triangle && Triangle->sides() == 3);
+  CHECK(Polygon && Polygon->sides() == 6);
+  CHECK(!Factory.CreateInstance("circle"));
+  CHECK(Factory.UnregisterClass("triangle"));
+  CHECK(!Factory.HasClass("triangle"));
+}
+
+TEST(static_registry) {
+  static_assert(!std::is_constructible<factory, decltype(factory::MakeStaticRegistry(factory::StaticClass<triangle>("triangle")))&&>::value,
+                "Factory must not bind temporary static registry");
+  factory Factory(registry);
+  CHECK(Factory.HasClass("triangle"));
+  CHECK(Factory.HasClass("polygon"));
+  std::unique_ptr<shape> Polygon(Factory.CreateInstance("polygon", 5));
+  CHECK(Polygon && Polygon->sides() == 5);
+  factory::InstancePtr Pooled = Factory.CreatePooledInstance("triangle");
+  CHECK(Pooled && Pooled->sides() == 3);
+  CHECK(Factory.RegisterClass<polygon>("square"));
+  CHECK(Factory.HasClass("square"));
+}
+
+TEST(constructor_nests_factory_calls) {
+  factory Factory;
+  Nested = &Factory;
+  CHECK(Factory.RegisterClass<nested, int>("nested"));
+  factory::InstancePtr Root = Factory.CreatePooledInstance("nested", 8);
+  CHECK(Root && Root->sides() == 8);
+  CHECK(!Factory.HasClass("nested"));
+  CHECK(Factory.RegisterClass<nested, int>("nested"));
+  std::unique_ptr<shape> Plain(Factory.CreateInstance("nested", 6));
+  CHECK(Plain && Plain->sides() == 6);
+  CHECK(!Factory.HasClass("nested"));
+  Root.reset();
+  Plain.reset();
+}
+
+TEST(constructor_unregisters_own_class) {
+  factory Factory;
+  Nested = &Factory;
+  CHECK(Factory.RegisterClass<transient>("transient"));
+  factory::InstancePtr Instance = Factory.CreatePooledInstance("transient");
+  CHECK(Instance && Instance->sides() == 1);
+  CHECK(!Factory.HasClass("transient"));
+  Instance.reset();
+}
+
+TEST(lookup_with_all_hazard_slots_taken) {
+  factory Factory(registry);
+  CHECK(Factory.RegisterClass<triangle>("runtime"));
+  hazard_domain::guard First, Second, Third;
+  hazard_domain::guard Reserved;
+  CHECK(Reserved.reserved());
+  std::unique_ptr<shape> Instance(Factory.CreateInstance("runtime"));
+  CHECK(Instance && Instance->sides() == 3);
+  factory::InstancePtr Pooled = Factory.CreatePooledInstance("runtime");
+  CHECK(Pooled && Pooled->sides() == 3);
+  CHECK(Factory.Resolve("runtime"));
+  CHECK(Factory.HasClass("runtime"));
+  CHECK(Factory.GetPoolStats("runtime").live() == 1);
+}
+
+TEST(instances_take_decayed_arguments) {
+  factory Factory;
+  Factory.RegisterClass<named, const char*>("named");
+  factory::InstanceArray Named = Factory.CreateInstances("named", 3, "hexagon");
+  CHECK(Named.size() == 3);
+  for (const shape& Shape : Named) CHECK(Shape.sides() == 7);
+}
+
+TEST(creation_requires_registered_signature) {
+  factory Factory(registry);
+  CHECK(Factory.RegisterClass<polygon, int>("hexagon"));
+  CHECK(Factory.RegisterClass<polygon>("square"));
+  factory::ClassHandle Hexagon = Factory.Resolve("hexagon");
+  CHECK(!Factory.CreateInstance("hexagon"));
+  CHECK(!Factory.CreateInstance(Hexagon));
+  CHECK(!Factory.CreatePooledInstance("hexagon"));
+  CHECK(!Factory.CreatePooledInstance(Hexagon));
+  CHECK(!Factory.CreateInstance("polygon"));
+  CHECK(!Factory.CreateInstances("hexagon", 2).size());
+  CHECK(!Factory.CreateInstance("square", 4));
+  std::unique_ptr<shape> Hexagon6(Factory.CreateInstance(Hexagon, 6));
+  std::unique_ptr<shape> Square(Factory.CreateInstance("square"));
+  CHECK(Hexagon6 && Hexagon6->sides() == 6);
+  CHECK(Square && Square->sides() == 0);
+}
+
+TEST(instances_overflowing_memory_throw) {
+  factory Factory;
+  Factory.RegisterClass<triangle>("triangle");
+  CHECK_THROWS(std::bad_array_new_length, Factory.CreateInstances("triangle", std::numeric_limits<std::size_t>::max() / 2));
+}
+
+TEST_MAIN()
@@ -0,0 +1,123 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include "dynamic_json.h"
+#include "dynamic_writer.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace {
+  //! Parse text, value is returned const so lookups never insert
+  const dynamic parse(const std::string & Text) {
+    return dynamic_json::parse(Text);
+  }
+
+  //! Check that parsing fails
+  bool invalid(const std::string & Text) {
+    try {
+      dynamic_json::parse(Text);
+    } catch (const dynamic_json::error &) {
+      return true;
+    }
+    return false;
+  }
+}
+
+TEST(escapes) {
+  CHECK(parse(R"("a\"b\\c\/d\be\ff\ng\rh\ti")").as_string_view() == "a\"b\\c/d\be\ff\ng\rh\ti");
+  CHECK(parse(R"("\u0041\u00e9\u20AC")").as_string_view() == "A\xC3\xA9\xE2\x82\xAC");
+  CHECK(parse(R"("\u0000")").as_string_view() == std::string_view("\0", 1));
+  CHECK(invalid(R"("\x")"));
+  CHECK(invalid(R"("\u12")"));
+  CHECK(invalid(R"("\u12G4")"));
+  CHECK(invalid("\"a\nb\""));
+  CHECK(invalid(R"("unterminated)"));
+}
+
+TEST(surrogates) {
+  CHECK(parse(R"("\ud83d\ude00")").as_string_view() == "\xF0\x9F\x98\x80");
+  CHECK(parse(R"("\uD800\uDC00")").as_string_view() == "\xF0\x90\x80\x80");
+  CHECK(invalid(R"("\ud83d")"));
+  CHECK(invalid(R"("\ud83dx")"));
+  CHECK(invalid(R"("\ud83dA")"));
+  CHECK(invalid(R"("\ude00")"));
+}
+
+TEST(numbers) {
+  CHECK(parse("0").kind() == dynamic::Kind::Int64);
+  CHECK(static_cast<std::int64_t>(parse("-0")) == 0);
+  CHECK(static_cast<std::int64_t>(parse("9223372036854775807")) == std::numeric_limits<std::int64_t>::max());
+  CHECK(static_cast<std::int64_t>(parse("-9223372036854775808")) == std::numeric_limits<std::int64_t>::min());
+  CHECK(parse("9223372036854775808").kind() == dynamic::Kind::UInt64);
+  CHECK(static_cast<std::uint64_t>(parse("18446744073709551615")) == std::numeric_limits<std::uint64_t>::max());
+  CHECK(parse("18446744073709551616").kind() == dynamic::Kind::Float64);
+  CHECK(parse("-9223372036854775809").kind() == dynamic::Kind::Float64);
+  CHECK(static_cast<double>(parse("1.5e3")) == 1500.0);
+  CHECK(static_cast<double>(parse("-2.5E-1")) == -0.25);
+  CHECK(parse("1e2").kind() == dynamic::Kind::Float64);
+  CHECK(invalid("01"));
+  CHECK(invalid("1."));
+  CHECK(invalid(".5"));
+  CHECK(invalid("-"));
+  CHECK(invalid("1e"));
+  CHECK(invalid("+1"));
+  CHECK(invalid("1e999"));
+}
+
+TEST(depth_limit) {
+  std::size_t Depth = dynamic_json::max_depth;
+  CHECK(parse(std::string(Depth, '[') + std::string(Depth, ']')).kind() == dynamic::Kind::Array);
+  CHECK(invalid(std::string(Depth + 2, '[') + std::string(Depth + 2, ']')));
+  std::string Objects;
+  for (std::size_t Index = 0; Index < Depth + 2; ++Index) Objects += "{\"a\":";
+  Objects += "1" + std::string(Depth + 2, '}');
+  CHECK(invalid(Objects));
+}
+
+TEST(duplicate_keys_keep_last) {
+  const dynamic Value = parse(R"({"b": 1, "a": 2, "b": 3, "c": 4, "b": 5})");
+  CHECK(Value.length() == 3);
+  CHECK(static_cast<int>(Value["a"]) == 2);
+  CHECK(static_cast<int>(Value["b"]) == 5);
+  CHECK(static_cast<int>(Value["c"]) == 4);
+}
+
+TEST(members_sorted_by_key) {
+  std::string Text = "{";
+  for (int Index = 9999; Index >= 0; --Index) Text += "\"k" + std::to_string(10000 + Index) + "\":" + std::to_string(Index) + (Index ? "," : "}");
+  const dynamic Value = parse(Text);
+  CHECK(Value.length() == 10000);
+  bool Sorted = true;
+  const dynamic::object_type & Members = Value.members();
+  for (std::size_t Index = 1; Index < Members.size(); ++Index)
+    Sorted = Sorted && Members[Index - 1].first.as_string_view() < Members[Index].first.as_string_view();
+  CHECK(Sorted);
+  CHECK(static_cast<int>(Value["k10042"]) == 42);
+}
+
+TEST(booleans_become_int8) {
+  const dynamic Value = parse("[true, false]");
+  CHECK(Value[0].kind() == dynamic::Kind::Int8);
+  CHECK(Value[1].kind() == dynamic::Kind::Int8);
+  CHECK(static_cast<int>(Value[0]) == 1);
+  CHECK(static_cast<int>(Value[1]) == 0);
+  std::string Text;
+  dynamic_writer Writer(Text);
+  Writer.write(Value);
+  Writer.flush();
+  CHECK(Text == "[1,0]");
+}
+
+TEST(document_values_in_arena) {
+  dynamic_json::document Document(R"({"list": [1, 2.5, "three", true, null], "empty": {}})");
+  const dynamic & Root = Document.root();
+  CHECK(Root["list"].length() == 5);
+  CHECK(static_cast<bool>(Root["list"][3]));
+  CHECK(Root["list"][4].kind() == dynamic::Kind::Undefined);
+  CHECK(Root["empty"].length() == 0);
+  CHECK(invalid(R"({"a": 1,})"));
+  CHECK(invalid(R"([1 2])"));
+  CHECK(invalid(R"({"a" 1})"));
+}
+
+TEST_MAIN()
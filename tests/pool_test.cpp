@@ -0,0 +1,119 @@
+#include "tests/test.h"
+#include "dynamic_factory.h"
+#include "object_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// - Live heap block counter, shows whether repeated work leaks
+namespace {
+  std::atomic<long> LiveBlocks{0};
+
+  void * allocate(std::size_t Size, std::size_t Alignment) {
+    Alignment = std::max(Alignment, sizeof(void*));
+    Size = (std::max<std::size_t>(Size, 1) + Alignment - 1) / Alignment * Alignment;
+    void * Result = std::aligned_alloc(Alignment, Size);
+    if (!Result) throw std::bad_alloc();
+    LiveBlocks.fetch_add(1, std::memory_order_relaxed);
+    return Result;
+  }
+
+  [[gnu::noinline]] void deallocate(void * Pointer) noexcept {
+    if (!Pointer) return;
+    LiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+    std::free(Pointer);
+  }
+}
+
+void * operator new (std::size_t Size)                                                {return allocate(Size, alignof(std::max_align_t));}
+void * operator new[] (std::size_t Size)                                              {return allocate(Size, alignof(std::max_align_t));}
+void * operator new (std::size_t Size, std::align_val_t Alignment)                    {return allocate(Size, static_cast<std::size_t>(Alignment));}
+void * operator new[] (std::size_t Size, std::align_val_t Alignment)                  {return allocate(Size, static_cast<std::size_t>(Alignment));}
+void operator delete (void * Pointer) noexcept                                        {deallocate(Pointer);}
+void operator delete[] (void * Pointer) noexcept                                      {deallocate(Pointer);}
+void operator delete (void * Pointer, std::size_t) noexcept                           {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::size_t) noexcept                         {deallocate(Pointer);}
+void operator delete (void * Pointer, std::align_val_t) noexcept                      {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::align_val_t) noexcept                    {deallocate(Pointer);}
+void operator delete (void * Pointer, std::size_t, std::align_val_t) noexcept         {deallocate(Pointer);}
+void operator delete[] (void * Pointer, std::size_t, std::align_val_t) noexcept       {deallocate(Pointer);}
+
+namespace {
+  struct base {
+    virtual ~base() {}
+  };
+
+  struct small : base {
+    int value = 1;
+  };
+
+  struct large : base {
+    char payload[1 << 20];
+  };
+
+  typedef dynamic_factory<base> factory;
+
+  //! Register class, create and release pooled instance on given number of threads, unregister it
+  void churn(factory & Factory, int Rounds, int Threads) {
+    for (int Round = 0; Round < Rounds; ++Round) {
+      std::string Name = "class" + std::to_string(Round);
+      Factory.RegisterClass<small>(Name);
+      std::vector<std::thread> Workers;
+      for (int Index = 0; Index < Threads; ++Index) Workers.emplace_back([&Factory, &Name] {
+        factory::InstancePtr Instance = Factory.CreatePooledInstance(Name);
+      });
+      for (std::thread & Worker : Workers) Worker.join();
+      Factory.UnregisterClass(Name);
+    }
+  }
+}
+
+TEST(large_objects_get_small_slabs) {
+  object_pool Pool(sizeof(large), alignof(large));
+  void * Block = Pool.allocate();
+  CHECK(Pool.stats().Capacity == 1);
+  Pool.deallocate(Block);
+}
+
+TEST(registration_creates_no_pool) {
+  factory Factory;
+  long Before = LiveBlocks.load();
+  Factory.RegisterClass<large>("large");
+  long Registered = LiveBlocks.load();
+  Factory.UnregisterClass("large");
+  CHECK(Registered - Before < 16);
+  CHECK(Factory.GetPoolStats("large").Slabs == 0);
+}
+
+TEST(pooled_instance_outlives_class_and_factory) {
+  factory::InstancePtr Instance;
+  {
+    factory Factory;
+    Factory.RegisterClass<small>("small");
+    Instance = Factory.CreatePooledInstance("small");
+    Factory.UnregisterClass("small");
+    for (int Index = 0; Index < 256; ++Index) {
+      Factory.RegisterClass<small>("filler");
+      Factory.UnregisterClass("filler");
+    }
+  }
+  CHECK(Instance && static_cast<small&>(*Instance).value == 1);
+  Instance.reset();
+}
+
+TEST(class_churn_does_not_grow_memory) {
+  factory Factory;
+  churn(Factory, 200, 2);
+  long Warm = LiveBlocks.load();
+  churn(Factory, 2000, 2);
+  long Done = LiveBlocks.load();
+  // - Retired snapshots waiting for reclamation are bounded, everything else is returned
+  CHECK(Done - Warm < 256);
+}
+
+TEST_MAIN()
@@ -0,0 +1,39 @@
+#include "tests/test.h"
+#include "prepared_dynamic.h"
+#include <cstdint>
+#include <optional>
+#include <typeinfo>
+
+TEST(cached_integer_casts_are_range_checked) {
+  prepared_dynamic Value = "300";
+  CHECK(Value.cast<std::int16_t>() == 300);
+  CHECK(Value.cast<std::uint64_t>() == 300);
+  CHECK_THROWS(std::bad_cast, Value.cast<std::int8_t>());
+  CHECK_THROWS(std::bad_cast, Value.cast<std::uint8_t>());
+  CHECK(Value.cast<std::int16_t>() == 300);
+}
+
+TEST(cached_casts_match_plain_dynamic) {
+  const char * Texts[] = {"-1", "255", "-129", "4294967296", "12abc", "3.5", " 42 ", "-9223372036854775808", "18446744073709551615"};
+  for (const char * Text : Texts) {
+    prepared_dynamic Prepared = Text;
+    dynamic Plain = Text;
+    auto same = [&](auto Width) {
+      typedef decltype(Width) T;
+      bool Thrown = false;
+      T Cached = 0;
+      try {
+        Cached = Prepared.cast<T>();
+      } catch (const std::bad_cast &) {
+        Thrown = true;
+      }
+      std::optional<T> Expected = Plain.try_cast<T>();
+      return Thrown ? !Expected : Expected == Cached;
+    };
+    CHECK(same(std::int8_t()) && same(std::int16_t()) && same(std::int32_t()) && same(std::int64_t()));
+    CHECK(same(std::uint8_t()) && same(std::uint16_t()) && same(std::uint32_t()) && same(std::uint64_t()));
+    CHECK(same(double()));
+  }
+}
+
+TEST_MAIN()
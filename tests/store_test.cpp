@@ -0,0 +1,154 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include "dynamic_store.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+  //! Size of store file header and table slot
+  constexpr std::size_t header_size = 64;
+  constexpr std::size_t slot_size   = 64;
+
+  //! Temporary store file removed at scope exit
+  struct temporary {
+    temporary(const char * Name) : Path("/tmp/dynamic_store_test_" + std::to_string(::getpid()) + "_" + Name) {remove();}
+    ~temporary() {remove();}
+    void remove() const {
+      std::remove(Path.c_str());
+      std::remove((Path + ".compact").c_str());
+    }
+    std::string Path;
+  };
+
+  //! Read whole file
+  std::vector<char> load(const std::string & Path) {
+    std::ifstream File(Path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+  }
+
+  //! Write whole file
+  void save(const std::string & Path, const std::vector<char> & Data) {
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    File.write(Data.data(), static_cast<std::streamsize>(Data.size()));
+  }
+
+  //! Get file offset of first used slot
+  std::size_t usedSlot(const std::vector<char> & Data) {
+    for (std::size_t Offset = header_size; Offset + slot_size <= Data.size(); Offset += slot_size)
+      if (Data[Offset + 24] == 1) return Offset;
+    return 0;
+  }
+
+  //! Write little endian integer into file image
+  template <typename T>
+  void poke(std::vector<char> & Data, std::size_t Offset, T Value) {
+    std::memcpy(Data.data() + Offset, &Value, sizeof(Value));
+  }
+
+  //! Create store with single value and check that modified image is rejected on open
+  template <typename Function>
+  bool rejected(const temporary & File, const dynamic & Value, Function && Corrupt) {
+    {
+      dynamic_store Store(File.Path);
+      Store.put("key", Value);
+    }
+    std::vector<char> Data = load(File.Path);
+    Corrupt(Data, usedSlot(Data));
+    save(File.Path, Data);
+    try {
+      dynamic_store Store(File.Path);
+    } catch (const std::runtime_error &) {
+      File.remove();
+      return true;
+    }
+    File.remove();
+    return false;
+  }
+}
+
+TEST(reopen_keeps_values) {
+  temporary File("reopen");
+  {
+    dynamic_store Store(File.Path);
+    Store.put("int", dynamic(static_cast<std::int32_t>(-7)));
+    Store.put("double", dynamic(2.5));
+    Store.put("short", dynamic("short"));
+    Store.put("long", dynamic(std::string(1000, 'l')));
+    Store.put("none", dynamic());
+    Store.sync();
+  }
+  dynamic_store Store(File.Path);
+  CHECK(Store.size() == 5);
+  CHECK(Store.at("int").get<std::int32_t>() == -7);
+  CHECK(Store.at("double").get<double>() == 2.5);
+  CHECK(Store.at("short").as_string_view() == "short");
+  CHECK(Store.at("long").as_string_view() == std::string(1000, 'l'));
+  CHECK(Store.at("none").kind() == dynamic::Kind::Undefined);
+  CHECK(!Store.contains("missing"));
+}
+
+TEST(rebuild_keeps_values) {
+  temporary File("rebuild");
+  dynamic_store Store(File.Path);
+  for (int Index = 0; Index < 1000; ++Index) Store.put("key" + std::to_string(Index), dynamic(std::string(100, static_cast<char>('a' + Index % 26))));
+  for (int Index = 0; Index < 1000; Index += 2) Store.erase("key" + std::to_string(Index));
+  Store.compact();
+  CHECK(Store.size() == 500);
+  CHECK(Store.garbage() == 0);
+  for (int Index = 1; Index < 1000; Index += 2)
+    CHECK(Store.at("key" + std::to_string(Index)).as_string_view() == std::string(100, static_cast<char>('a' + Index % 26)));
+  CHECK(!Store.contains("key0"));
+  dynamic_store Reopened(std::move(Store));
+  CHECK(Reopened.size() == 500);
+}
+
+TEST(open_does_not_modify_file) {
+  temporary File("readonly");
+  {
+    dynamic_store Store(File.Path);
+    Store.put("short", dynamic(7));
+    Store.put("long", dynamic(std::string(100, 'v')));
+  }
+  std::vector<char> Before = load(File.Path);
+  std::uint32_t Version;
+  std::memcpy(&Version, Before.data() + 8, sizeof(Version));
+  CHECK(Version == 1);
+  {
+    dynamic_store Store(File.Path);
+    CHECK(Store.size() == 2);
+  }
+  CHECK(load(File.Path) == Before);
+}
+
+TEST(corrupt_file_is_rejected) {
+  temporary File("corrupt");
+  auto Header = [](std::vector<char> & Data, std::size_t) {Data[0] = 'X';};
+  auto Truncated = [](std::vector<char> & Data, std::size_t) {Data.resize(header_size + slot_size);};
+  auto Key = [](std::vector<char> & Data, std::size_t Slot) {poke<std::uint64_t>(Data, Slot + 8, 1ull << 40);};
+  auto KeySize = [](std::vector<char> & Data, std::size_t Slot) {poke<std::uint32_t>(Data, Slot + 16, 0xFFFFFFFFu);};
+  auto Payload = [](std::vector<char> & Data, std::size_t Slot) {poke<std::uint64_t>(Data, Slot + 32, 1ull << 40);};
+  auto Size = [](std::vector<char> & Data, std::size_t Slot) {poke<std::uint32_t>(Data, Slot + 20, 0x7FFFFFFFu);};
+  auto Tag = [](std::vector<char> & Data, std::size_t Slot) {Data[Slot + 25] = 13;};
+  auto State = [](std::vector<char> & Data, std::size_t Slot) {Data[Slot + 24] = 7;};
+  auto Slots = [](std::vector<char> & Data, std::size_t) {poke<std::uint64_t>(Data, 16, 1ull << 60);};
+  dynamic Long(std::string(100, 'v'));
+  CHECK(rejected(File, Long, Header));
+  CHECK(rejected(File, Long, Truncated));
+  CHECK(rejected(File, Long, Key));
+  CHECK(rejected(File, Long, KeySize));
+  CHECK(rejected(File, Long, Payload));
+  CHECK(rejected(File, Long, Size));
+  CHECK(rejected(File, Long, Tag));
+  CHECK(rejected(File, Long, State));
+  CHECK(rejected(File, Long, Slots));
+  CHECK(rejected(File, dynamic(1.0), Size));
+}
+
+TEST_MAIN()
@@ -0,0 +1,88 @@
+/*
+ * TEST is minimal test harness for dynamic unit tests
+ *
+ *
+ */
+#pragma once
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <vector>
+
+namespace test {
+
+  //! Registered test case
+  struct entry {
+    const char            * Name;
+    std::function<void()>   Body;
+  };
+
+  //! Registered test cases of current executable
+  inline std::vector<entry> & entries() {
+    static std::vector<entry> Entries;
+    return Entries;
+  }
+
+  //! Number of failed checks of current test case
+  inline int & failures() {
+    static int Failures = 0;
+    return Failures;
+  }
+
+  //! Register test case at static initialization
+  struct registrar {
+    registrar(const char * Name, std::function<void()> Body) {entries().push_back({Name, std::move(Body)});}
+  };
+
+  //! Report failed check
+  inline void fail(const char * File, int Line, const char * Expression) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", File, Line, Expression);
+    ++failures();
+  }
+
+  //! Run all registered test cases, return process exit code
+  inline int run() {
+    int Failed = 0;
+    for (const entry & Entry : entries()) {
+      failures() = 0;
+      try {
+        Entry.Body();
+      } catch (const std::exception & Error) {
+        std::fprintf(stderr, "%s: unexpected exception: %s\n", Entry.Name, Error.what());
+        ++failures();
+      } catch (...) {
+        std::fprintf(stderr, "%s: unexpected exception\n", Entry.Name);
+        ++failures();
+      }
+      std::printf("%s %s\n", failures() ? "FAIL" : "ok  ", Entry.Name);
+      if (failures()) ++Failed;
+    }
+    std::printf("%zu tests, %d failed\n", entries().size(), Failed);
+    return Failed ? 1 : 0;
+  }
+
+} // namespace test
+
+#define TEST_CONCAT_(First, Second) First##Second
+#define TEST_CONCAT(First, Second) TEST_CONCAT_(First, Second)
+
+//! Define test case
+#define TEST(Name) \
+  static void Name(); \
+  static test::registrar TEST_CONCAT(Name, _registrar)(#Name, &Name); \
+  static void Name()
+
+//! Check condition, test case continues on failure
+#define CHECK(...) \
+  do { if (!(__VA_ARGS__)) test::fail(__FILE__, __LINE__, #__VA_ARGS__); } while (false)
+
+//! Check that expression throws given exception type
+#define CHECK_THROWS(Exception, ...) \
+  do { \
+    bool Thrown_ = false; \
+    try {(void)(__VA_ARGS__);} catch (const Exception &) {Thrown_ = true;} catch (...) {} \
+    if (!Thrown_) test::fail(__FILE__, __LINE__, #__VA_ARGS__ " throws " #Exception); \
+  } while (false)
+
+//! Run all test cases of executable
+#define TEST_MAIN() int main() {return test::run();}
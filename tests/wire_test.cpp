@@ -0,0 +1,106 @@
+#include "tests/test.h"
+#include "dynamic.h"
+#include "dynamic_wire.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+  //! Encode values as batch
+  std::vector<std::uint8_t> encode(const std::vector<dynamic> & Values) {
+    std::vector<std::uint8_t> Buffer(1024);
+    dynamic_encoder Encoder(Buffer.data(), Buffer.size());
+    Encoder.write(Values.begin(), Values.end());
+    Buffer.resize(Encoder.size());
+    return Buffer;
+  }
+}
+
+TEST(tags_are_frozen) {
+  CHECK(static_cast<int>(dynamic_wire::Tag::Undefined) == 0);
+  CHECK(static_cast<int>(dynamic_wire::Tag::Int8) == 1);
+  CHECK(static_cast<int>(dynamic_wire::Tag::Int64) == 4);
+  CHECK(static_cast<int>(dynamic_wire::Tag::UInt8) == 5);
+  CHECK(static_cast<int>(dynamic_wire::Tag::UInt64) == 8);
+  CHECK(static_cast<int>(dynamic_wire::Tag::Float32) == 9);
+  CHECK(static_cast<int>(dynamic_wire::Tag::Float64) == 10);
+  CHECK(static_cast<int>(dynamic_wire::Tag::String) == 11);
+  CHECK(static_cast<int>(dynamic_wire::Tag::Binary) == 12);
+  CHECK(dynamic_wire::uuid_tag == 14);
+}
+
+TEST(golden_bytes) {
+  std::vector<dynamic> Values = {
+    dynamic(),
+    dynamic(static_cast<std::int8_t>(-5)),
+    dynamic(static_cast<std::uint16_t>(0x1234)),
+    dynamic(static_cast<std::int32_t>(1)),
+    dynamic(static_cast<std::uint64_t>(0x0102030405060708ull)),
+    dynamic(2.0f),
+    dynamic(1.5),
+    dynamic("ab"),
+    dynamic(std::vector<std::uint8_t>{0x01, 0x02}),
+  };
+  std::vector<std::uint8_t> Expected = {
+    0x09,
+    0x00,
+    0x01, 0xFB,
+    0x06, 0x34, 0x12,
+    0x03, 0x01, 0x00, 0x00, 0x00,
+    0x08, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+    0x09, 0x00, 0x00, 0x00, 0x40,
+    0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x3F,
+    0x0B, 0x02, 'a', 'b',
+    0x0C, 0x02, 0x01, 0x02,
+  };
+  CHECK(encode(Values) == Expected);
+}
+
+TEST(round_trip) {
+  std::vector<dynamic> Values = {
+    dynamic(),
+    dynamic(static_cast<std::int16_t>(-300)),
+    dynamic(static_cast<std::int64_t>(-1)),
+    dynamic(static_cast<std::uint8_t>(200)),
+    dynamic(static_cast<std::uint32_t>(4000000000u)),
+    dynamic(-0.25f),
+    dynamic(3.25),
+    dynamic(std::string(300, 's')),
+    dynamic(std::vector<std::uint8_t>(200, 0x7F)),
+  };
+  std::vector<std::uint8_t> Buffer = encode(Values);
+  dynamic_decoder Decoder(Buffer.data(), Buffer.size());
+  std::vector<dynamic_view> Views;
+  Decoder.read(Views);
+  CHECK(Decoder.atEnd());
+  CHECK(Views.size() == Values.size());
+  for (std::size_t Index = 0; Index < Views.size() && Index < Values.size(); ++Index) {
+    dynamic Decoded = Views[Index].materialize();
+    CHECK(Views[Index].kind() == Values[Index].kind());
+    CHECK(Decoded.kind() == Values[Index].kind());
+    CHECK(std::equal(Decoded.data(), Decoded.data() + Decoded.size(), Values[Index].data(), Values[Index].data() + Values[Index].size()));
+  }
+}
+
+TEST(unknown_and_truncated_input_is_rejected) {
+  for (std::uint8_t Tag : {std::uint8_t(13), std::uint8_t(15), std::uint8_t(16), std::uint8_t(0xFF)}) {
+    std::uint8_t Data[] = {Tag, 0x00};
+    dynamic_decoder Decoder(Data, sizeof(Data));
+    CHECK_THROWS(std::bad_cast, Decoder.read());
+  }
+  std::uint8_t Truncated[] = {0x04, 0x01, 0x02};
+  dynamic_decoder Decoder(Truncated, sizeof(Truncated));
+  CHECK_THROWS(std::length_error, Decoder.read());
+}
+
+TEST(array_is_not_encodable) {
+  std::uint8_t Buffer[16];
+  dynamic_encoder Encoder(Buffer, sizeof(Buffer));
+  dynamic Array = dynamic::array();
+  CHECK_THROWS(std::bad_cast, Encoder.write(Array));
+}
+
+TEST_MAIN()
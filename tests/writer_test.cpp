@@ -0,0 +1,69 @@
+#include "tests/test.h"
+#include "dynamic_writer.h"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+  //! Binary value of given size with varying bytes
+  dynamic binary(std::size_t Size) {
+    std::vector<std::uint8_t> Bytes(Size);
+    for (std::size_t Index = 0; Index < Size; ++Index) Bytes[Index] = static_cast<std::uint8_t>(Index * 7 + 3);
+    return dynamic(std::move(Bytes));
+  }
+
+  //! Write value into growable string
+  std::string grown(const dynamic & Value) {
+    std::string Result;
+    dynamic_writer Writer(Result);
+    Writer.write(Value);
+    Writer.flush();
+    return Result;
+  }
+
+  //! Write value into fixed buffer of given size, full buffers are collected by sink
+  std::string chunked(const dynamic & Value, std::size_t BufferSize) {
+    std::string Result;
+    std::vector<char> Buffer(BufferSize);
+    dynamic_writer Writer(Buffer.data(), Buffer.size(), [&Result](const char * Data, std::size_t Size) {Result.append(Data, Size);});
+    Writer.write(Value);
+    Writer.flush();
+    return Result;
+  }
+}
+
+TEST(json_scalars_and_containers) {
+  dynamic Value;
+  Value["text"] = "a\"b\n";
+  Value["list"].push_back(1);
+  Value["list"].push_back(2.5);
+  Value["list"].push_back(std::nan(""));
+  Value["list"].push_back(dynamic());
+  CHECK(grown(Value) == "{\"list\":[1,2.5,null,null],\"text\":\"a\\\"b\\n\"}");
+}
+
+TEST(base64_in_small_fixed_buffer_with_sink) {
+  CHECK(grown(binary(4)) == "\"AwoRGA==\"");
+  dynamic Value = binary(1000);
+  std::string Expected = grown(Value);
+  CHECK(Expected.size() == 2 + 4 * 334);
+  CHECK(chunked(Value, 1024) == Expected);
+  CHECK(chunked(Value, 7) == Expected);
+  CHECK(chunked(binary(5000), 4096) == grown(binary(5000)));
+}
+
+TEST(long_string_passes_through_sink) {
+  dynamic Value = std::string(5000, 'x');
+  CHECK(chunked(Value, 64) == "\"" + std::string(5000, 'x') + "\"");
+}
+
+TEST(fixed_buffer_without_sink_overflows) {
+  char Buffer[8];
+  dynamic_writer Writer(Buffer, sizeof(Buffer));
+  CHECK_THROWS(std::overflow_error, Writer.write(dynamic(std::string(100, 'x'))));
+}
+
+TEST_MAIN()